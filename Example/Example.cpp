@@ -28,6 +28,7 @@ SOFTWARE.
 #include <LInput/Buttons/Extensions/ButtonsStdExtension.h>
 #include <LInput/Buttons/Extensions/MultiTapExtensions.h>
 #include <LInput/Keys/KeyCodeHelper.h>
+#include <LInput/Keys/KeyboardState.h>
 #include <LInput/Keys/KeyCombination.h>
 #include <LInput/Mouse/MouseButton.h>
 #include <LInput/Mouse/MouseButtonHelper.h>
@@ -40,14 +41,22 @@ namespace LInput
 	template <typename T>
 	using DeviceGroup = std::map < uint8_t, T>;
 
-	using KeyboardButtonType = uint16_t;
-	constexpr KeyboardButtonType MaxKeyBoardButtons = 58000;
-	using KeyboardButtonstate = LInput::ButtonsState<KeyboardButtonType, MaxKeyBoardButtons>;
+	// Keyboard buttons are dense key indices, see KeyCodeIndex.
+	using KeyboardButtonType = KeyIndex;
+	using KeyboardButtonstate = LInput::DenseKeyboardState;
 	using KeyboardGroup = DeviceGroup<KeyboardButtonstate>;
+	using KeyboardStdExtension = ButtonStdExtension<KeyboardButtonType, KeyCodeIndex::Count>;
+	using KeyboardMultitapExtension = MultitapExtension<KeyboardButtonType, KeyCodeIndex::Count>;
 
-	using MouseButtonstate = LInput::ButtonsState<uint8_t, 8>;
+	// Mouse extensions are known at compile time, use the static extension pipeline.
+	using MouseStdExtension = ButtonStdExtension<uint8_t, RawInput::MaxMouseButtons>;
+	using MouseMultitapExtension = MultitapExtension<uint8_t, RawInput::MaxMouseButtons>;
+	using MouseButtonstate = LInput::StaticButtonsState<uint8_t, RawInput::MaxMouseButtons, MouseStdExtension, MouseMultitapExtension>;
 	using MouseGroup = DeviceGroup<MouseButtonstate>;
-	using HIDButtonState = LInput::ButtonsState<uint8_t, 32>;
+	// Number of gamepad buttons the example tracks.
+	constexpr size_t MaxHIDButtons = 128;
+	using HIDStdExtension = ButtonStdExtension<uint8_t, MaxHIDButtons>;
+	using HIDButtonState = LInput::ButtonsState<uint8_t, MaxHIDButtons>;
 	using HIDGroup = DeviceGroup<HIDButtonState>;
 
 
@@ -68,19 +77,19 @@ namespace LInput
 
 
 
-		void OnKeyBoardEvent(const LInput::ButtonStdExtension<KeyboardButtonType>::ButtonEvent& btnEvent)
+		void OnKeyBoardEvent(const KeyboardStdExtension::ButtonEvent& btnEvent)
 		{
 			using namespace  LInput;
 
 
-			std::string buttonName = KeyCodeHelper::KeyCodeToString(static_cast<KeyCode>(btnEvent.button));
+			std::string buttonName(KeyCodeHelper::KeyCodeToString(KeyCodeIndex::ToKeyCode(btnEvent.button)));
 			ParseButtonEvent(btnEvent.eventType, btnEvent.parent->GetID(), buttonName, btnEvent.counter, btnEvent.repeatCount, c, btnEvent.actuationTime);
 
-			if (static_cast<KeyCode>(btnEvent.button) == KeyCode::Q && btnEvent.counter >= 2)
+			if (KeyCodeIndex::ToKeyCode(btnEvent.button) == KeyCode::Q && btnEvent.counter >= 2)
 				PostQuitMessage(0);
 		}
 
-		void OnMouseMultiTap(const LInput::MultitapExtension<uint8_t>::MultiTapEvent& multiTapEvent)
+		void OnMouseMultiTap(const MouseMultitapExtension::MultiTapEvent& multiTapEvent)
 		{
 			using namespace LInput;
 			std::string nameofEvent = "MultiTap";
@@ -93,25 +102,25 @@ namespace LInput
 
 
 
-		void OnKeyBoardMultiTap(const LInput::MultitapExtension<KeyboardButtonType>::MultiTapEvent& multiTapEvent)
+		void OnKeyBoardMultiTap(const KeyboardMultitapExtension::MultiTapEvent& multiTapEvent)
 		{
 			using namespace LInput;
 			std::string nameofEvent = "MultiTap";
-			std::string buttonName = KeyCodeHelper::KeyCodeToString(static_cast<KeyCode>(multiTapEvent.button));
+			std::string buttonName(KeyCodeHelper::KeyCodeToString(KeyCodeIndex::ToKeyCode(multiTapEvent.button)));
 			std::string msg = std::to_string(c++) + " [Device ID:" + std::to_string(multiTapEvent.parent->GetID()) + "] " + buttonName + " " + nameofEvent + " tap count: " + std::to_string(multiTapEvent.tapCount) + '\n';
 			std::cout << msg;
 
 
 		}
 
-		void OnMouseEvent(const LInput::ButtonStdExtension<uint8_t>::ButtonEvent& btnEvent)
+		void OnMouseEvent(const MouseStdExtension::ButtonEvent& btnEvent)
 		{
 			using namespace  LInput;
 			std::string buttonName = MouseCodeHelper::MouseCodeToString(static_cast<MouseButton>(btnEvent.button));
 			ParseButtonEvent(btnEvent.eventType, btnEvent.parent->GetID(), buttonName, btnEvent.counter, btnEvent.repeatCount, c, btnEvent.actuationTime);
 		}
 
-		void OnHIDEvent(const LInput::ButtonStdExtension<uint8_t>::ButtonEvent& btnEvent)
+		void OnHIDEvent(const HIDStdExtension::ButtonEvent& btnEvent)
 		{
 			using namespace  LInput;
 			static int c = 0;
@@ -156,19 +165,22 @@ namespace LInput
 				{
 					it = keyboardState.emplace(evnt.deviceIndex, decltype(keyboardState)::mapped_type()).first;
 
-					auto stdExtension = std::make_shared< ButtonStdExtension<KeyboardButtonType>>(evnt.deviceIndex, multiPressRate, repeatRate);
+					auto stdExtension = std::make_shared<KeyboardStdExtension>(evnt.deviceIndex, multiPressRate, repeatRate);
 					it->second.AddExtension(std::static_pointer_cast <KeyboardButtonstate::ExtensionType::element_type>(stdExtension));
 					stdExtension->OnButtonEvent.Add(std::bind(&Example::OnKeyBoardEvent, this, std::placeholders::_1));
 
 					//Add multitap extension for click, double click and triple click
 
-					auto multitapextension = std::make_shared<MultitapExtension<KeyboardButtonType>>(evnt.deviceIndex, 200, 4);
+					auto multitapextension = std::make_shared<KeyboardMultitapExtension>(evnt.deviceIndex, 200, 4);
 					multitapextension->OnButtonEvent.Add(std::bind(&Example::OnKeyBoardMultiTap, this, std::placeholders::_1));
 					it->second.AddExtension(std::static_pointer_cast<IButtonStateExtension<KeyboardButtonType>>(multitapextension));
 				}
 
 
-				it->second.SetButtonState(static_cast<decltype(keyboardState)::mapped_type::underlying_button_type>(keyEvent.scanCode), keyEvent.state);
+				// Unknown scan codes have no dense index.
+				const KeyIndex keyIndex = KeyCodeIndex::ToIndex(keyEvent.scanCode);
+				if (KeyCodeIndex::IsValid(keyIndex))
+					it->second.SetButtonState(keyIndex, keyEvent.state, evnt.timeStamp);
 
 
 
@@ -182,23 +194,18 @@ namespace LInput
 				//if mouse ID not found add new buttonstates entry.
 				if (it == std::end(mouseState))
 				{
-					it = mouseState.emplace(evnt.deviceIndex, decltype(mouseState)::mapped_type()).first;
-					//Add standard extension
-					auto stdExtension = std::make_shared<ButtonStdExtension<uint8_t>>(evnt.deviceIndex, multiPressRate, repeatRate);
-					stdExtension->OnButtonEvent.Add(std::bind(&Example::OnMouseEvent, this, std::placeholders::_1));
-					it->second.AddExtension(std::static_pointer_cast<IButtonStateExtension<uint8_t>>(stdExtension));
-
-					//Add multitap extension for click, double click and triple click
+					//Add standard extension and multitap extension for click, double click and triple click
+					it = mouseState.emplace(std::piecewise_construct, std::forward_as_tuple(evnt.deviceIndex)
+						, std::forward_as_tuple(std::piecewise_construct
+							, std::forward_as_tuple(evnt.deviceIndex, multiPressRate, repeatRate)
+							, std::forward_as_tuple(evnt.deviceIndex, 200, 4))).first;
 
-					auto multitapextension = std::make_shared<MultitapExtension<uint8_t>>(evnt.deviceIndex, 200, 4);
-					multitapextension->OnButtonEvent.Add(std::bind(&Example::OnMouseMultiTap, this, std::placeholders::_1));
-					it->second.AddExtension(std::static_pointer_cast<IButtonStateExtension<uint8_t>>(multitapextension));
+					it->second.GetExtension<MouseStdExtension>().OnButtonEvent.Add(std::bind(&Example::OnMouseEvent, this, std::placeholders::_1));
+					it->second.GetExtension<MouseMultitapExtension>().OnButtonEvent.Add(std::bind(&Example::OnMouseMultiTap, this, std::placeholders::_1));
 
 				}
 
-				for (size_t i = 0; i < RawInput::MaxMouseButtons; i++)
-
-					it->second.SetButtonState(static_cast<decltype(mouseState)::mapped_type::underlying_button_type>(i), mouseEvent.buttonState[i]);
+				it->second.SetButtonStates(mouseEvent.buttonState, mouseEvent.buttonStateValid, 0, evnt.timeStamp);
 
 				if (mouseEvent.wheelDelta != 0)
 				{
@@ -219,15 +226,18 @@ namespace LInput
 				{
 					it = hidState.emplace(evnt.deviceIndex, decltype(hidState)::mapped_type()).first;
 
-					auto stdExtension = std::make_shared<ButtonStdExtension<uint8_t>>(evnt.deviceIndex, multiPressRate, repeatRate);
+					auto stdExtension = std::make_shared<HIDStdExtension>(evnt.deviceIndex, multiPressRate, repeatRate);
 					it->second.AddExtension(std::static_pointer_cast<IButtonStateExtension<uint8_t>>(stdExtension));
 					stdExtension->OnButtonEvent.Add(std::bind(&Example::OnHIDEvent,this, std::placeholders::_1));
 				}
 
 
 
-				for (size_t i = 0; i < RawInput::MaxHIDButtons; i++)
-					it->second.SetButtonState(static_cast<decltype(hidState)::mapped_type::underlying_button_type>(i), hidEvent.buttonState[i]);
+				const GamepadState& gamepad = *hidEvent.state;
+				// Only the toggled buttons are applied.
+				for (size_t word = 0; word < gamepad.GetButtonWordCount(); word++)
+					if (gamepad.GetChangedButtonWord(word) != 0)
+						it->second.SetButtonStates(gamepad.GetButtonWord(word), gamepad.GetChangedButtonWord(word), word * 32, evnt.timeStamp);
 			}
 		}
 		private:
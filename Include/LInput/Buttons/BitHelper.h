@@ -0,0 +1,87 @@
+/*
+Copyright (c) 2020 Lior Lahav
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LINPUT_HAS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace LInput
+{
+	class BitHelper
+	{
+	public:
+		static int PopCount(uint64_t value)
+		{
+#if defined(__GNUC__) || defined(__clang__)
+			return __builtin_popcountll(value);
+#else
+			// SWAR popcount, the popcnt instruction is not guaranteed to exist on every x64 CPU.
+			value = value - ((value >> 1) & 0x5555555555555555ull);
+			value = (value & 0x3333333333333333ull) + ((value >> 2) & 0x3333333333333333ull);
+			value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+			return static_cast<int>((value * 0x0101010101010101ull) >> 56);
+#endif
+		}
+
+		/// <summary>
+		/// Index of the lowest set bit, value must not be zero.
+		/// </summary>
+		static int CountTrailingZeros(uint64_t value)
+		{
+#if defined(__GNUC__) || defined(__clang__)
+			return __builtin_ctzll(value);
+#elif defined(_M_X64) || defined(_M_ARM64)
+			unsigned long index;
+			_BitScanForward64(&index, value);
+			return static_cast<int>(index);
+#else
+			unsigned long index;
+			if (_BitScanForward(&index, static_cast<unsigned long>(value)) != 0)
+				return static_cast<int>(index);
+			_BitScanForward(&index, static_cast<unsigned long>(value >> 32));
+			return static_cast<int>(index) + 32;
+#endif
+		}
+
+		/// <summary>
+		/// Invokes func(bitIndex) for every set bit of 'value', lowest bit first.
+		/// </summary>
+		template <typename Func>
+		static void ForEachSetBit(uint64_t value, Func&& func)
+		{
+			while (value != 0)
+			{
+				func(static_cast<size_t>(CountTrailingZeros(value)));
+				value &= value - 1;
+			}
+		}
+	};
+}
@@ -0,0 +1,185 @@
+/*
+Copyright (c) 2020 Lior Lahav
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <LInput/Buttons/BitHelper.h>
+
+namespace LInput
+{
+	/// <summary>
+	/// Fixed size bit set holding one bit per button, a set bit means the button is down.
+	/// Whole set operations work on 64 bit words, two words at a time when SSE2 is available.
+	/// </summary>
+	template <size_t NUM_BITS>
+	class ButtonBitSet
+	{
+	public:
+		using word_type = uint64_t;
+		static constexpr size_t BitsPerWord = sizeof(word_type) * 8;
+		static constexpr size_t NumBits = NUM_BITS;
+		static constexpr size_t NumWords = NUM_BITS == 0 ? 1 : (NUM_BITS + BitsPerWord - 1) / BitsPerWord;
+
+		bool Test(size_t bit) const
+		{
+			return (fWords[bit / BitsPerWord] & (word_type{ 1 } << (bit % BitsPerWord))) != 0;
+		}
+
+		void Set(size_t bit, bool value)
+		{
+			const word_type mask = word_type{ 1 } << (bit % BitsPerWord);
+			word_type& word = fWords[bit / BitsPerWord];
+			word = value ? (word | mask) : (word & ~mask);
+		}
+
+		void Reset()
+		{
+			fWords.fill(0);
+		}
+
+		word_type GetWord(size_t index) const
+		{
+			return fWords[index];
+		}
+
+		void SetWord(size_t index, word_type value)
+		{
+			fWords[index] = value;
+		}
+
+		/// <summary>
+		/// Returns 'count' (up to 64) consecutive bits starting at 'firstBit', bits past the end of the set read as zero.
+		/// </summary>
+		word_type GetBits(size_t firstBit, size_t count) const
+		{
+			const size_t wordIndex = firstBit / BitsPerWord;
+			const size_t shift = firstBit % BitsPerWord;
+			if (wordIndex >= NumWords)
+				return 0;
+
+			word_type bits = fWords[wordIndex] >> shift;
+			if (shift != 0 && wordIndex + 1 < NumWords)
+				bits |= fWords[wordIndex + 1] << (BitsPerWord - shift);
+
+			return count >= BitsPerWord ? bits : bits & ((word_type{ 1 } << count) - 1);
+		}
+
+		const word_type* data() const
+		{
+			return fWords.data();
+		}
+
+		/// <summary>
+		/// Number of set bits.
+		/// </summary>
+		size_t Count() const
+		{
+			size_t count = 0;
+			for (const word_type word : fWords)
+				count += static_cast<size_t>(BitHelper::PopCount(word));
+			return count;
+		}
+
+		/// <summary>
+		/// Returns true if at least one bit is set.
+		/// </summary>
+		bool Any() const
+		{
+			size_t i = 0;
+#ifdef LINPUT_HAS_SSE2
+			__m128i accumulator = _mm_setzero_si128();
+			for (; i + 2 <= NumWords; i += 2)
+				accumulator = _mm_or_si128(accumulator, _mm_load_si128(reinterpret_cast<const __m128i*>(fWords.data() + i)));
+
+			if (_mm_movemask_epi8(_mm_cmpeq_epi8(accumulator, _mm_setzero_si128())) != 0xFFFF)
+				return true;
+#endif
+			word_type accumulatorScalar = 0;
+			for (; i < NumWords; i++)
+				accumulatorScalar |= fWords[i];
+
+			return accumulatorScalar != 0;
+		}
+
+		/// <summary>
+		/// Invokes func(bitIndex) for every set bit, lowest first.
+		/// </summary>
+		template <typename Func>
+		void ForEachSet(Func&& func) const
+		{
+			for (size_t i = 0; i < NumWords; i++)
+			{
+				const size_t base = i * BitsPerWord;
+				BitHelper::ForEachSetBit(fWords[i], [&](size_t bit) { func(base + bit); });
+			}
+		}
+
+		/// <summary>
+		/// XORs this set against 'other' and invokes func(bitIndex) for every bit that differs.
+		/// Blocks of 128 identical bits are skipped with a single compare.
+		/// </summary>
+		template <typename Func>
+		void ForEachChanged(const ButtonBitSet& other, Func&& func) const
+		{
+			size_t i = 0;
+#ifdef LINPUT_HAS_SSE2
+			for (; i + 2 <= NumWords; i += 2)
+			{
+				const __m128i lhs = _mm_load_si128(reinterpret_cast<const __m128i*>(fWords.data() + i));
+				const __m128i rhs = _mm_load_si128(reinterpret_cast<const __m128i*>(other.fWords.data() + i));
+				if (_mm_movemask_epi8(_mm_cmpeq_epi8(lhs, rhs)) == 0xFFFF)
+					continue;
+
+				BitHelper::ForEachSetBit(fWords[i] ^ other.fWords[i], [&](size_t bit) { func(i * BitsPerWord + bit); });
+				BitHelper::ForEachSetBit(fWords[i + 1] ^ other.fWords[i + 1], [&](size_t bit) { func((i + 1) * BitsPerWord + bit); });
+			}
+#endif
+			for (; i < NumWords; i++)
+				BitHelper::ForEachSetBit(fWords[i] ^ other.fWords[i], [&](size_t bit) { func(i * BitsPerWord + bit); });
+		}
+
+		/// <summary>
+		/// Writes the indices of the bits that differ between this set and 'other' to 'out'.
+		/// </summary>
+		template <typename OutputIt>
+		OutputIt Diff(const ButtonBitSet& other, OutputIt out) const
+		{
+			ForEachChanged(other, [&out](size_t bit) { *out++ = bit; });
+			return out;
+		}
+
+		bool operator==(const ButtonBitSet& rhs) const
+		{
+			return fWords == rhs.fWords;
+		}
+
+		bool operator!=(const ButtonBitSet& rhs) const
+		{
+			return !(*this == rhs);
+		}
+
+	private:
+		alignas(16) std::array<word_type, NumWords> fWords{};
+	};
+}
@@ -22,13 +22,19 @@ SOFTWARE.
 
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include <map>
 #include <memory>
 #include <LLUtils/StopWatch.h>
 #include <LInput/Buttons/ButtonState.h>
+#include <LInput/Buttons/ButtonBitSet.h>
 #include <LInput/Buttons/IButtonStateExtension.h>
+#include <LInput/Timing/Clock.h>
 #include <LLUtils/Event.h>
 
 namespace LInput
@@ -38,55 +44,235 @@ namespace LInput
 	class IButtonState
 	{
 	public:
-		virtual void SetButtonState(button_type button, ButtonState state) = 0;
+		virtual void SetButtonState(button_type button, ButtonState state, SteadyClock::tick_type timeStamp = TimeStampNow) = 0;
 		virtual ButtonState GetButtonState(button_type button) const = 0;
 		virtual ~IButtonState() = default;
 	};
 
-	template <typename button_type, size_t NUM_BUTTONS = MaxValue<button_type>>
-	class ButtonsState  : public IButtonState<button_type> 
+	/// <summary>
+	/// Packed button state storage shared by ButtonsState and StaticButtonsState.
+	/// Transitions are forwarded to Derived::RaiseButtonState.
+	/// </summary>
+	template <typename button_type, size_t NUM_BUTTONS, typename Derived>
+	class ButtonsStateBase : public IButtonState<button_type>
 	{
 	public:
-		using ExtensionType = std::shared_ptr<IButtonStateExtension<button_type>>;
-		using VecExtensionsType = std::vector<ExtensionType>;
 		using underlying_button_type = button_type;
-	
-
-	public:
-
-		ButtonsState()
-		{
-			fButtonStates.fill(ButtonState::Up);
-		}
+		/// <summary>
+		/// Packed 'down' state of all the buttons, one bit per button.
+		/// </summary>
+		using Snapshot = ButtonBitSet<NUM_BUTTONS>;
 
 		ButtonState GetButtonState(button_type  buttonId) const override
 		{
-			return fButtonStates[static_cast<size_t>( buttonId)];
+			return fButtonsDown.Test(static_cast<size_t>(buttonId)) ? ButtonState::Down : ButtonState::Up;
 
 		}
 
+		/// <summary>
+		/// 'timeStamp' - capture time of the transition in nanoseconds, forwarded to the extensions, TimeStampNow to have each extension read its clock.
+		/// </summary>
 		// Get the state of a button whether it's down or up
-		void SetButtonState(button_type button, ButtonState newState) override
+		void SetButtonState(button_type button, ButtonState newState, SteadyClock::tick_type timeStamp = TimeStampNow) override
 		{
-			
-			ButtonState oldState = fButtonStates[static_cast<size_t>(button)];
+			const size_t buttonIndex = static_cast<size_t>(button);
+			ButtonState oldState = fButtonsDown.Test(buttonIndex) ? ButtonState::Down : ButtonState::Up;
 			
 			if (oldState != newState && newState != ButtonState::NotSet)
 			{
-				fButtonStates[static_cast<size_t>(button)] = newState;
-				for (ExtensionType& e : fButtonExtensions)
-					e->SetButtonState(button, newState);
-
+				fButtonsDown.Set(buttonIndex, newState == ButtonState::Down);
+				static_cast<Derived*>(this)->RaiseButtonState(button, newState, timeStamp);
 			}
 		}
 
+		/// <summary>
+		/// Batch update of up to 64 buttons starting at 'firstButton'.
+		/// bit i of 'buttonsDown' is the new state of button firstButton + i, it's applied only if bit i of 'buttonsValid' is set.
+		/// Only buttons that actually changed state are dispatched to the extensions, all with the same 'timeStamp'.
+		/// </summary>
+		template <typename mask_type>
+		void SetButtonStates(mask_type buttonsDown, mask_type buttonsValid, size_t firstButton = 0, SteadyClock::tick_type timeStamp = TimeStampNow)
+		{
+			static_assert(std::is_unsigned_v<mask_type> && sizeof(mask_type) <= sizeof(typename Snapshot::word_type), "mask type must be an unsigned integer of up to 64 bits");
+			constexpr size_t maskBits = sizeof(mask_type) * 8;
+			using word_type = typename Snapshot::word_type;
+
+			// Ignore bits past the last button.
+			const size_t buttonsInRange = NUM_BUTTONS > firstButton ? NUM_BUTTONS - firstButton : 0;
+			const word_type rangeMask = buttonsInRange >= Snapshot::BitsPerWord ? ~word_type{ 0 } : (word_type{ 1 } << buttonsInRange) - 1;
+
+			const word_type current = fButtonsDown.GetBits(firstButton, maskBits);
+			const word_type changed = (current ^ static_cast<word_type>(buttonsDown)) & static_cast<word_type>(buttonsValid) & rangeMask;
+
+			BitHelper::ForEachSetBit(changed, [&](size_t bit)
+			{
+				const size_t buttonIndex = firstButton + bit;
+				const bool down = (static_cast<word_type>(buttonsDown) & (word_type{ 1 } << bit)) != 0;
+				fButtonsDown.Set(buttonIndex, down);
+				static_cast<Derived*>(this)->RaiseButtonState(static_cast<button_type>(buttonIndex), down ? ButtonState::Down : ButtonState::Up, timeStamp);
+			});
+		}
+
+		/// <summary>
+		/// Returns the current state of all the buttons, copy it to keep a snapshot for later diffing.
+		/// </summary>
+		const Snapshot& GetSnapshot() const
+		{
+			return fButtonsDown;
+		}
+
+		size_t GetDownCount() const
+		{
+			return fButtonsDown.Count();
+		}
+
+		bool AnyDown() const
+		{
+			return fButtonsDown.Any();
+		}
+
+		/// <summary>
+		/// Writes to 'out' every button whose state differs between 'previous' and the current state.
+		/// </summary>
+		template <typename OutputIt>
+		OutputIt GetChangedButtons(const Snapshot& previous, OutputIt out) const
+		{
+			fButtonsDown.ForEachChanged(previous, [&out](size_t button) { *out++ = static_cast<button_type>(button); });
+			return out;
+		}
+
+	private:
+		Snapshot fButtonsDown;
+	};
+
+	/// <summary>
+	/// Button states with a runtime list of extensions, extensions are called through IButtonStateExtension.
+	/// </summary>
+	template <typename button_type, size_t NUM_BUTTONS = MaxValue<button_type>>
+	class ButtonsState  : public ButtonsStateBase<button_type, NUM_BUTTONS, ButtonsState<button_type, NUM_BUTTONS>>
+	{
+	public:
+		using ExtensionType = std::shared_ptr<IButtonStateExtension<button_type>>;
+		using VecExtensionsType = std::vector<ExtensionType>;
+
 		void AddExtension(ExtensionType extension)
 		{
 			fButtonExtensions.push_back(extension);
 		}
+
+		/// <summary>
+		/// Earliest deadline of all the extensions, used by hosts that drive extensions created with TimingMode::Host.
+		/// </summary>
+		SteadyClock::tick_type NextDeadline() const
+		{
+			SteadyClock::tick_type deadline = SteadyClock::NoDeadline;
+			for (const ExtensionType& e : fButtonExtensions)
+				deadline = (std::min)(deadline, e->NextDeadline());
+			return deadline;
+		}
+
+		void Advance(SteadyClock::tick_type now)
+		{
+			for (ExtensionType& e : fButtonExtensions)
+				e->Advance(now);
+		}
+
 	private:
+		friend class ButtonsStateBase<button_type, NUM_BUTTONS, ButtonsState>;
+
+		void RaiseButtonState(button_type button, ButtonState newState, SteadyClock::tick_type timeStamp)
+		{
+			for (ExtensionType& e : fButtonExtensions)
+				e->SetButtonState(button, newState, timeStamp);
+		}
+
 		VecExtensionsType fButtonExtensions;
-		std::array<ButtonState, NUM_BUTTONS> fButtonStates;
+	};
+
+	/// <summary>
+	/// Button states with a compile time list of extensions held by value.
+	/// Extensions are called directly in declaration order, which lets the compiler inline them into the transition path.
+	/// e.g. StaticButtonsState<uint8_t, 8, ButtonStdExtension<uint8_t>, MultitapExtension<uint8_t>> mouse(std::piecewise_construct
+	///     , std::forward_as_tuple(id, multiPressRate, repeatRate), std::forward_as_tuple(id, 200, 4));
+	/// </summary>
+	template <typename button_type, size_t NUM_BUTTONS, typename... Extensions>
+	class StaticButtonsState final : public ButtonsStateBase<button_type, NUM_BUTTONS, StaticButtonsState<button_type, NUM_BUTTONS, Extensions...>>
+	{
+	private:
+		// Constructs the extension in place from a tuple of constructor arguments, extensions are not required to be movable.
+		template <typename Extension>
+		struct ExtensionHolder
+		{
+			ExtensionHolder() = default;
+
+			template <typename... Args>
+			explicit ExtensionHolder(std::tuple<Args...>&& args) : ExtensionHolder(std::move(args), std::index_sequence_for<Args...>{}) {}
+
+			template <typename Tuple, size_t... Indices>
+			ExtensionHolder(Tuple&& args, std::index_sequence<Indices...>) : extension(std::get<Indices>(std::forward<Tuple>(args))...) {}
+
+			Extension extension;
+		};
+
+	public:
+		StaticButtonsState() = default;
+
+		/// <summary>
+		/// Constructs each extension from the matching tuple of constructor arguments.
+		/// </summary>
+		template <typename... ExtensionArgs>
+		explicit StaticButtonsState(std::piecewise_construct_t, ExtensionArgs&&... extensionArgs) : fExtensions(std::forward<ExtensionArgs>(extensionArgs)...)
+		{
+			static_assert(sizeof...(ExtensionArgs) == sizeof...(Extensions), "an argument tuple is required for each extension");
+		}
+
+		StaticButtonsState(const StaticButtonsState&) = delete;
+		StaticButtonsState& operator=(const StaticButtonsState&) = delete;
+
+		template <size_t Index>
+		auto& GetExtension()
+		{
+			return std::get<Index>(fExtensions).extension;
+		}
+
+		template <typename Extension>
+		Extension& GetExtension()
+		{
+			return std::get<ExtensionHolder<Extension>>(fExtensions).extension;
+		}
+
+		/// <summary>
+		/// Earliest deadline of all the extensions, used by hosts that drive extensions created with TimingMode::Host.
+		/// </summary>
+		SteadyClock::tick_type NextDeadline() const
+		{
+			return std::apply([](const ExtensionHolder<Extensions>&... holders)
+			{
+				SteadyClock::tick_type deadline = SteadyClock::NoDeadline;
+				((deadline = (std::min)(deadline, holders.extension.NextDeadline())), ...);
+				return deadline;
+			}, fExtensions);
+		}
+
+		void Advance(SteadyClock::tick_type now)
+		{
+			std::apply([now](ExtensionHolder<Extensions>&... holders)
+			{
+				(holders.extension.Advance(now), ...);
+			}, fExtensions);
+		}
+
+	private:
+		friend class ButtonsStateBase<button_type, NUM_BUTTONS, StaticButtonsState>;
+
+		void RaiseButtonState(button_type button, ButtonState newState, SteadyClock::tick_type timeStamp)
+		{
+			std::apply([button, newState, timeStamp](ExtensionHolder<Extensions>&... holders)
+			{
+				(holders.extension.SetButtonState(button, newState, timeStamp), ...);
+			}, fExtensions);
+		}
 
+		std::tuple<ExtensionHolder<Extensions>...> fExtensions;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,180 @@
+/*
+Copyright (c) 2020 Lior Lahav
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <map>
+#include <type_traits>
+
+namespace LInput
+{
+	/// <summary>
+	/// Links of an intrusive ButtonList, per button data types derive from it.
+	/// </summary>
+	template <typename T>
+	struct ButtonListNode
+	{
+		T* prev = nullptr;
+		T* next = nullptr;
+		bool linked = false;
+	};
+
+	/// <summary>
+	/// Intrusive doubly linked list of per button data, insertion and removal don't allocate.
+	/// </summary>
+	template <typename T>
+	class ButtonList
+	{
+	public:
+		bool empty() const
+		{
+			return fHead == nullptr;
+		}
+
+		T* front() const
+		{
+			return fHead;
+		}
+
+		bool contains(const T& item) const
+		{
+			return item.linked;
+		}
+
+		void push_back(T& item)
+		{
+			if (item.linked)
+				erase(item);
+
+			item.prev = fTail;
+			item.next = nullptr;
+			item.linked = true;
+			if (fTail != nullptr)
+				fTail->next = &item;
+			else
+				fHead = &item;
+			fTail = &item;
+		}
+
+		void erase(T& item)
+		{
+			if (item.linked == false)
+				return;
+
+			if (item.prev != nullptr)
+				item.prev->next = item.next;
+			else
+				fHead = item.next;
+
+			if (item.next != nullptr)
+				item.next->prev = item.prev;
+			else
+				fTail = item.prev;
+
+			item.prev = nullptr;
+			item.next = nullptr;
+			item.linked = false;
+		}
+
+		/// <summary>
+		/// Invokes func(T&) for every item, the current item may be erased by func.
+		/// </summary>
+		template <typename Func>
+		void ForEach(Func&& func)
+		{
+			for (T* item = fHead; item != nullptr;)
+			{
+				T* next = item->next;
+				func(*item);
+				item = next;
+			}
+		}
+
+	private:
+		T* fHead = nullptr;
+		T* fTail = nullptr;
+	};
+
+	/// <summary>
+	/// Per button data in a flat array, for bounded button types, e.g. mouse, HID and dense keyboard indices.
+	/// data_type must have a 'button' member.
+	/// </summary>
+	template <typename button_type, typename data_type, size_t NUM_BUTTONS>
+	class ButtonDataArray
+	{
+	public:
+		ButtonDataArray()
+		{
+			for (size_t i = 0; i < NUM_BUTTONS; i++)
+				fButtonsData[i].button = static_cast<button_type>(i);
+		}
+
+		ButtonDataArray(const ButtonDataArray&) = delete;
+		ButtonDataArray& operator=(const ButtonDataArray&) = delete;
+
+		data_type& Get(button_type button)
+		{
+			return fButtonsData[static_cast<size_t>(button)];
+		}
+
+	private:
+		std::array<data_type, NUM_BUTTONS> fButtonsData;
+	};
+
+	/// <summary>
+	/// Per button data in a map, for sparse or unbounded button types, data is created on first access.
+	/// data_type must have a 'button' member.
+	/// </summary>
+	template <typename button_type, typename data_type>
+	class ButtonDataMap
+	{
+	public:
+		ButtonDataMap() = default;
+		ButtonDataMap(const ButtonDataMap&) = delete;
+		ButtonDataMap& operator=(const ButtonDataMap&) = delete;
+
+		data_type& Get(button_type button)
+		{
+			auto it = fButtonsData.find(button);
+			if (it == fButtonsData.end())
+			{
+				it = fButtonsData.emplace(button, data_type{}).first;
+				it->second.button = button;
+			}
+
+			return it->second;
+		}
+
+	private:
+		std::map<button_type, data_type> fButtonsData;
+	};
+
+	/// <summary>
+	/// Storage policy for per button data, NUM_BUTTONS = 0 means the number of buttons is unbounded.
+	/// </summary>
+	template <typename button_type, typename data_type, size_t NUM_BUTTONS>
+	using ButtonDataStorage = std::conditional_t<NUM_BUTTONS == 0
+		, ButtonDataMap<button_type, data_type>
+		, ButtonDataArray<button_type, data_type, NUM_BUTTONS>>;
+}
@@ -23,15 +23,18 @@ SOFTWARE.
 
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
+#include <memory>
+#include <mutex>
 #include <vector>
-#include <map>
-#include <set>
-#include <LLUtils/StopWatch.h>
 #include <LLUtils/Event.h>
 #include <LInput/Buttons/ButtonState.h>
 #include <LInput/Buttons/IButtonStateExtension.h>
-#include <Win32/HighPrecisionTimer.h>
+#include <LInput/Buttons/Extensions/ButtonDataStorage.h>
+#include <LInput/Buttons/Extensions/DeadlineHeap.h>
+#include <LInput/Timing/Clock.h>
+#include <LInput/Timing/TimerService.h>
 
 
 namespace LInput
@@ -39,29 +42,42 @@ namespace LInput
 
 	enum class EventType { NotSet, Pressed, Released };
 	
-	template <typename button_type>
+	/// <summary>
+	/// NUM_BUTTONS - number of buttons when bounded, per button data is then kept in a flat array, 0 - unbounded, data is kept in a map.
+	/// clock_type - clock policy timestamps and deadlines are taken from, see SteadyClock.
+	/// In TimingMode::TimerService the methods are serialized with the timer callback by the TimerService lock and events are raised while
+	/// it's held, handlers must not wait for another thread that schedules timers.
+	/// </summary>
+	template <typename button_type, size_t NUM_BUTTONS = 0, typename clock_type = SteadyClock>
 	class ButtonStdExtension final : public IButtonStateExtension<button_type>
 	{
 
 	
 	public:
 		
-		ButtonStdExtension(uint8_t id, uint16_t multipressRate, uint16_t repeatRate) :
+		ButtonStdExtension(uint8_t id, uint16_t multipressRate, uint16_t repeatRate, TimingMode timingMode = TimingMode::TimerService) :
 		  fID(id)
 		, fMultiPressRate(multipressRate)
 		, fRepeatRate(repeatRate)
 		
 		{
-			timer.SetDueTime(fRepeatRate);
-			timer.SetRepeatInterval(fRepeatRate);
+			// Bounded buttons never allocate on the input path.
+			fRepeatQueue.reserve(NUM_BUTTONS);
+			if (timingMode == TimingMode::TimerService)
+				fRepeatTimer = std::make_unique<TimerService::Timer>([this] { TimerCallback(); });
 		}
 
 
+		static constexpr uint64_t NoTimeStamp = SteadyClock::NoDeadline;
+
 		///////////////////////
 		// Button event            
 		struct ButtonEvent
 		{
 			ButtonStdExtension* parent;
+			/// <summary>
+			/// Capture time of the transition in nanoseconds on clock_type, for repeats the time the repeat was due.
+			/// </summary>
 			uint64_t timeStamp;
 			button_type button;
 			EventType eventType;
@@ -74,7 +90,7 @@ namespace LInput
 			/// </summary>
 			uint16_t repeatCount;
 			/// <summary>
-			/// Total actuation time
+			/// Total actuation time in milliseconds
 			/// </summary>
 			uint16_t actuationTime;
 		};
@@ -84,9 +100,16 @@ namespace LInput
 		typedef std::vector<ButtonEvent> ListButtonEvent;
 		///////////////////////
 
-		struct ButtonData
+		/// <summary>
+		/// While the button is held and repeats are enabled, the node deadline is the time of the next repeat.
+		/// </summary>
+		struct ButtonData : DeadlineHeapNode<ButtonData>
 		{
-			uint64_t timeStamp = 0;
+			button_type button{};
+			/// <summary>
+			/// Time of the last transition, NoTimeStamp before the first one.
+			/// </summary>
+			uint64_t timeStamp = NoTimeStamp;
 			ButtonState buttonState = ButtonState::Up;
 			uint16_t pressCounter = 0;
 			uint64_t actuationTimeStamp = 0;
@@ -99,39 +122,83 @@ namespace LInput
 
 		ButtonData& GetButtonData(button_type buttonId)
 		{
-			auto it = mMapButttons.find(buttonId);
-			if (it == mMapButttons.end())
-				it = mMapButttons.emplace(buttonId, ButtonData {}).first;
-
-			return it->second;
+			return fButtonsData.Get(buttonId);
 		}
 
 
-		void ProcessQueuedButtons()
+		/// <summary>
+		/// Raises the repeat events due up to 'now', only buttons that are due are visited.
+		/// Returns the time of the next repeat.
+		/// </summary>
+		SteadyClock::tick_type ProcessQueuedButtons(SteadyClock::tick_type now)
 		{
-			for (auto& button : fPressedButtons)
+			const auto lock = LockTimer();
+			const SteadyClock::tick_type repeatInterval = fRepeatRate * SteadyClock::TicksPerMillisecond;
+			while (repeatInterval != 0 && fRepeatQueue.empty() == false && fRepeatQueue.top().deadline <= now)
 			{
-				auto& buttonData = GetButtonData(button);
-				uint64_t now = static_cast<uint64_t>(fTimer.GetElapsedTimeInteger(LLUtils::StopWatch::Milliseconds));
-
-				if (static_cast<uint64_t>(now) - buttonData.repeatTimeStamp > fRepeatRate)
-				{
-					buttonData.repeatCount++;
-					OnButtonEvent.Raise(ButtonEvent{ this, 0,button,EventType::Pressed,buttonData.pressCounter, buttonData.repeatCount , static_cast<uint16_t>(now - buttonData.actuationTimeStamp) });
-					buttonData.repeatTimeStamp = now;
-				}
+				ButtonData& buttonData = fRepeatQueue.top();
+				const SteadyClock::tick_type due = buttonData.deadline;
+				buttonData.repeatCount++;
+				buttonData.repeatTimeStamp = due;
+
+				// Repeats missed while the consumer was behind are dropped, the next repeat stays on the device time grid.
+				SteadyClock::tick_type nextRepeat = due + repeatInterval;
+				if (nextRepeat <= now)
+					nextRepeat = now - (now - due) % repeatInterval + repeatInterval;
+
+				// Re-queued before raising the event, a handler may release the button.
+				fRepeatQueue.update(buttonData, nextRepeat);
+				OnButtonEvent.Raise(ButtonEvent{ this, due,buttonData.button,EventType::Pressed,buttonData.pressCounter, buttonData.repeatCount , ToMilliseconds(due - buttonData.actuationTimeStamp) });
 			}
+
+			return fRepeatQueue.empty() ? SteadyClock::NoDeadline : fRepeatQueue.top().deadline;
 		}
 
 		void TimerCallback()
 		{
-			ProcessQueuedButtons();
+			const SteadyClock::tick_type now = clock_type::Now();
+			if (now < fDeadline && fDeadline != SteadyClock::NoDeadline)
+				ArmTimer(fDeadline, now); // clock_type runs behind the service clock.
+			else
+				Advance(now);
+		}
+
+		SteadyClock::tick_type NextDeadline() const override
+		{
+			const auto lock = LockTimer();
+			return fDeadline;
+		}
+
+		void Advance(SteadyClock::tick_type now) override
+		{
+			const auto lock = LockTimer();
+			if (now < fDeadline)
+				return;
+
+			fDeadline = SteadyClock::NoDeadline;
+			ScheduleDeadline(ProcessQueuedButtons(now));
 		}
 
 	public:
+		/// <summary>
+		/// Zero disables repeats, held buttons stop repeating.
+		/// </summary>
 		void SetRepeatRate(uint16_t repeatRate)
 		{
+			const auto lock = LockTimer();
 			fRepeatRate = repeatRate;
+			if (fRepeatRate == 0)
+			{
+				while (fRepeatQueue.empty() == false)
+				{
+					ButtonData& buttonData = fRepeatQueue.top();
+					buttonData.actuationTimeStamp = 0;
+					buttonData.repeatTimeStamp = 0;
+					buttonData.repeatCount = 0;
+					fRepeatQueue.pop();
+				}
+				CancelDeadline();
+			}
 		}
 
 		uint16_t GetRepeatRate() const
@@ -139,16 +206,31 @@ namespace LInput
 			return fRepeatRate;
 		}
 
+		/// <summary>
+		/// Delay in milliseconds between the press and the first repeat, 0 to use the repeat rate.
+		/// </summary>
+		void SetRepeatDelay(uint16_t repeatDelay)
+		{
+			const auto lock = LockTimer();
+			fRepeatDelay = repeatDelay;
+		}
+
+		uint16_t GetRepeatDelay() const
+		{
+			return fRepeatDelay;
+		}
+
 
 	
 	
 		uint8_t GetID() const { return fID; }
 		// Get the state of a button whether it's down or up
-		 void SetButtonState(button_type button, ButtonState newState) override
+		 void SetButtonState(button_type button, ButtonState newState, SteadyClock::tick_type timeStamp = TimeStampNow) override
 		{
+			const auto lock = LockTimer();
 			ButtonData& buttonData = GetButtonData(button);
-			const uint64_t currentTimeStamp = static_cast<uint64_t>(fTimer.GetElapsedTimeInteger(LLUtils::StopWatch::Milliseconds));
-			const bool multiPressTHreshold = buttonData.timeStamp != 0 && (currentTimeStamp - buttonData.timeStamp) < fMultiPressRate;
+			const uint64_t currentTimeStamp = timeStamp != TimeStampNow ? timeStamp : clock_type::Now();
+			const bool multiPressTHreshold = buttonData.timeStamp != NoTimeStamp && (currentTimeStamp - buttonData.timeStamp) < fMultiPressRate * SteadyClock::TicksPerMillisecond;
 
 			if (buttonData.buttonState != newState)
 			{
@@ -164,30 +246,32 @@ namespace LInput
 
 						if (fRepeatRate > 0)
 						{
-							fPressedButtons.insert(button);
+							const SteadyClock::tick_type firstRepeat = currentTimeStamp + (fRepeatDelay != 0 ? fRepeatDelay : fRepeatRate) * SteadyClock::TicksPerMillisecond;
+							fRepeatQueue.push(buttonData, firstRepeat);
 							buttonData.actuationTimeStamp = currentTimeStamp;
 							buttonData.repeatTimeStamp = currentTimeStamp;
-							timer.Enable(true);
+							ScheduleDeadline(firstRepeat);
 						}
 
-						OnButtonEvent.Raise(ButtonEvent{this,0 ,button,EventType::Pressed,buttonData.pressCounter, buttonData.repeatCount ,0 });
+						OnButtonEvent.Raise(ButtonEvent{this,currentTimeStamp ,button,EventType::Pressed,buttonData.pressCounter, buttonData.repeatCount ,0 });
 
 					}
 				}
 				if (newState == ButtonState::Up)
 				{
-					if (fRepeatRate > 0)
+					// Erased regardless of the current rate, it may have been set to zero while the button was held.
+					if (fRepeatQueue.contains(buttonData))
 					{
-						fPressedButtons.erase(button);
-						if (fPressedButtons.empty() == true)
-							timer.Enable(false);
+						fRepeatQueue.erase(buttonData);
+						if (fRepeatQueue.empty() == true)
+							CancelDeadline();
 						
 						buttonData.actuationTimeStamp = 0;
 						buttonData.repeatTimeStamp = 0;
 						buttonData.repeatCount = 0;
 					}
 					
-					OnButtonEvent.Raise(ButtonEvent{this, 0,button,EventType::Released,buttonData.pressCounter, buttonData.repeatCount ,0});
+					OnButtonEvent.Raise(ButtonEvent{this, currentTimeStamp,button,EventType::Released,buttonData.pressCounter, buttonData.repeatCount ,0});
 					
 					if (multiPressTHreshold == false)
 						buttonData.pressCounter = 0;
@@ -200,6 +284,47 @@ namespace LInput
 
 		}
 	private:
+
+		/// <summary>
+		/// Serializes with the timer callback in TimingMode::TimerService, an empty lock in TimingMode::Host.
+		/// </summary>
+		std::unique_lock<std::recursive_mutex> LockTimer() const
+		{
+			return fRepeatTimer != nullptr ? fRepeatTimer->Lock() : std::unique_lock<std::recursive_mutex>();
+		}
+
+		/// <summary>
+		/// Moves the pending deadline to 'deadline' if it's earlier.
+		/// </summary>
+		void ScheduleDeadline(SteadyClock::tick_type deadline)
+		{
+			if (deadline >= fDeadline)
+				return;
+
+			fDeadline = deadline;
+			if (fRepeatTimer != nullptr)
+				ArmTimer(deadline, clock_type::Now());
+		}
+
+		/// <summary>
+		/// Translates 'deadline' from clock_type to the TimerService clock.
+		/// </summary>
+		void ArmTimer(SteadyClock::tick_type deadline, SteadyClock::tick_type now)
+		{
+			fRepeatTimer->ScheduleAt(SteadyClock::Now() + (deadline > now ? deadline - now : 0));
+		}
+
+		static uint16_t ToMilliseconds(SteadyClock::tick_type ticks)
+		{
+			return static_cast<uint16_t>((std::min)(ticks / SteadyClock::TicksPerMillisecond, SteadyClock::tick_type{ UINT16_MAX }));
+		}
+
+		void CancelDeadline()
+		{
+			fDeadline = SteadyClock::NoDeadline;
+			if (fRepeatTimer != nullptr)
+				fRepeatTimer->Cancel();
+		}
 		
 		uint8_t fID = 0;
 		/// <summary>
@@ -210,13 +335,22 @@ namespace LInput
 		/// the repeat rate in milliseconds, set to zero (0) to disable repeat rate
 		/// </summary>
 		uint16_t fRepeatRate = 15;
-		::Win32::HighPrecisionTimer timer = ::Win32::HighPrecisionTimer(std::bind(&ButtonStdExtension::TimerCallback, this));
-		LLUtils::StopWatch fTimer = LLUtils::StopWatch(true);
-		using MapButtonToData = std::map<button_type, ButtonData>;
-		MapButtonToData mMapButttons;
 		/// <summary>
-		/// used for sending key repeaet signals to the client
+		/// delay in milliseconds before the first repeat, zero (0) to use the repeat rate
+		/// </summary>
+		uint16_t fRepeatDelay = 0;
+		/// <summary>
+		/// Time the timer is armed for, may be earlier than the next repeat after a button is released.
+		/// </summary>
+		SteadyClock::tick_type fDeadline = SteadyClock::NoDeadline;
+		ButtonDataStorage<button_type, ButtonData, NUM_BUTTONS> fButtonsData;
+		/// <summary>
+		/// Held buttons ordered by the time of their next repeat.
+		/// </summary>
+		DeadlineHeap<ButtonData> fRepeatQueue;
+		/// <summary>
+		/// Null in TimingMode::Host. Declared last so it's cancelled before the state its callback uses is destroyed.
 		/// </summary>
-		std::set<button_type> fPressedButtons;
+		std::unique_ptr<TimerService::Timer> fRepeatTimer;
 	};
 }
\ No newline at end of file
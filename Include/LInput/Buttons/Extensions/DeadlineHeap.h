@@ -0,0 +1,184 @@
+/*
+Copyright (c) 2020 Lior Lahav
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace LInput
+{
+	/// <summary>
+	/// Heap position and deadline of an item of an intrusive DeadlineHeap, per button data types derive from it.
+	/// </summary>
+	template <typename T>
+	struct DeadlineHeapNode
+	{
+		static constexpr size_t NotInHeap = (std::numeric_limits<size_t>::max)();
+
+		uint64_t deadline = 0;
+		size_t heapIndex = NotInHeap;
+	};
+
+	/// <summary>
+	/// Intrusive indexed binary min-heap of per button data ordered by deadline.
+	/// Each item stores its own heap position, so the earliest deadline is O(1) and insert, update and erase are O(log n).
+	/// Insertion doesn't allocate once the capacity is reserved.
+	/// </summary>
+	template <typename T>
+	class DeadlineHeap
+	{
+	public:
+		using Node = DeadlineHeapNode<T>;
+
+		void reserve(size_t capacity)
+		{
+			fItems.reserve(capacity);
+		}
+
+		bool empty() const
+		{
+			return fItems.empty();
+		}
+
+		size_t size() const
+		{
+			return fItems.size();
+		}
+
+		/// <summary>
+		/// The item with the earliest deadline, the heap must not be empty.
+		/// </summary>
+		T& top() const
+		{
+			return *fItems.front();
+		}
+
+		bool contains(const T& item) const
+		{
+			return item.heapIndex != Node::NotInHeap;
+		}
+
+		/// <summary>
+		/// Inserts 'item' with 'deadline' or moves it to 'deadline' if it's already in the heap.
+		/// </summary>
+		void push(T& item, uint64_t deadline)
+		{
+			if (contains(item))
+			{
+				update(item, deadline);
+				return;
+			}
+
+			item.deadline = deadline;
+			item.heapIndex = fItems.size();
+			fItems.push_back(&item);
+			SiftUp(item.heapIndex);
+		}
+
+		void update(T& item, uint64_t deadline)
+		{
+			const uint64_t oldDeadline = item.deadline;
+			item.deadline = deadline;
+			if (deadline < oldDeadline)
+				SiftUp(item.heapIndex);
+			else
+				SiftDown(item.heapIndex);
+		}
+
+		void erase(T& item)
+		{
+			if (contains(item) == false)
+				return;
+
+			const size_t index = item.heapIndex;
+			const size_t last = fItems.size() - 1;
+			item.heapIndex = Node::NotInHeap;
+
+			if (index != last)
+			{
+				T* moved = fItems[last];
+				Place(index, moved);
+				fItems.pop_back();
+				// The moved item may belong either above or below its new position.
+				SiftUp(index);
+				SiftDown(moved->heapIndex);
+			}
+			else
+			{
+				fItems.pop_back();
+			}
+		}
+
+		void pop()
+		{
+			erase(top());
+		}
+
+	private:
+		void Place(size_t index, T* item)
+		{
+			fItems[index] = item;
+			item->heapIndex = index;
+		}
+
+		void SiftUp(size_t index)
+		{
+			T* item = fItems[index];
+			while (index > 0)
+			{
+				const size_t parent = (index - 1) / 2;
+				if (fItems[parent]->deadline <= item->deadline)
+					break;
+
+				Place(index, fItems[parent]);
+				index = parent;
+			}
+			Place(index, item);
+		}
+
+		void SiftDown(size_t index)
+		{
+			T* item = fItems[index];
+			const size_t count = fItems.size();
+			for (;;)
+			{
+				size_t child = index * 2 + 1;
+				if (child >= count)
+					break;
+
+				if (child + 1 < count && fItems[child + 1]->deadline < fItems[child]->deadline)
+					child++;
+
+				if (item->deadline <= fItems[child]->deadline)
+					break;
+
+				Place(index, fItems[child]);
+				index = child;
+			}
+			Place(index, item);
+		}
+
+		std::vector<T*> fItems;
+	};
+}
@@ -0,0 +1,457 @@
+/*
+Copyright (c) 2020 Lior Lahav
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <LLUtils/Event.h>
+#include <LLUtils/Exception.h>
+#include <LInput/Buttons/ButtonState.h>
+#include <LInput/Buttons/IButtonStateExtension.h>
+#include <LInput/Buttons/Extensions/ButtonDataStorage.h>
+#include <LInput/Buttons/Extensions/DeadlineHeap.h>
+#include <LInput/Timing/Clock.h>
+#include <LInput/Timing/TimerService.h>
+
+
+namespace LInput
+{
+	enum class GestureType : uint8_t
+	{
+		  Tap	// N presses, each starting within a time window of the previous release.
+		, Hold	// Button held down for at least a given time.
+		, Click	// Button pressed and released within a given time.
+		, Chord	// A set of buttons all pressed within a time window.
+	};
+
+	/// <summary>
+	/// Recognizes declared gestures with a single per button automaton, one pass over each transition regardless of the number of gestures.
+	/// Tap, hold and click gestures are compiled into per tap count tables and sorted thresholds shared by all the buttons,
+	/// chords are indexed by their member buttons. All per button deadlines are kept in one DeadlineHeap.
+	/// A hold cancels the tap sequence it's part of.
+	/// NUM_BUTTONS - number of buttons when bounded, per button data is then kept in a flat array, 0 - unbounded, data is kept in a map.
+	/// clock_type - clock policy timestamps and deadlines are taken from, see SteadyClock.
+	/// In TimingMode::TimerService the methods are serialized with the timer callback by the TimerService lock and events are raised while
+	/// it's held, handlers must not wait for another thread that schedules timers.
+	/// </summary>
+	template <typename button_type, size_t NUM_BUTTONS = 0, typename clock_type = SteadyClock>
+	class GestureExtension final : public IButtonStateExtension<button_type>
+	{
+	public:
+		using GestureID = uint16_t;
+		static constexpr GestureID NoGesture = (std::numeric_limits<GestureID>::max)();
+
+		GestureExtension(uint16_t id, TimingMode timingMode = TimingMode::TimerService) : fID(id)
+		{
+			fDeadlines.reserve(NUM_BUTTONS);
+			if (timingMode == TimingMode::TimerService)
+				fTimer = std::make_unique<TimerService::Timer>([this] { TimerCallback(); });
+		}
+
+		struct GestureEvent
+		{
+			GestureExtension* parent;
+			GestureID gesture;
+			GestureType type;
+			/// <summary>
+			/// The button that completed the gesture.
+			/// </summary>
+			button_type button;
+			/// <summary>
+			/// Number of taps for GestureType::Tap, otherwise the position of the press in its tap sequence.
+			/// </summary>
+			uint16_t tapCount;
+			/// <summary>
+			/// Time the gesture was recognized in nanoseconds on clock_type.
+			/// </summary>
+			uint64_t timeStamp;
+		};
+
+		LLUtils::Event<void(const GestureEvent&)> OnGesture;
+
+		/// <summary>
+		/// 'taps' presses of the same button, each starting at most 'windowMs' after the previous release.
+		/// </summary>
+		GestureID AddTap(uint16_t taps, uint16_t windowMs)
+		{
+			const auto lock = LockTimer();
+			if (taps == 0)
+				LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "A tap gesture requires at least one tap");
+
+			const GestureID gesture = NextGestureID();
+			fTaps.push_back({ gesture, taps, ToTicks(windowMs) });
+			CompileTaps();
+			return gesture;
+		}
+
+		/// <summary>
+		/// Button held down for at least 'holdMs'.
+		/// </summary>
+		GestureID AddHold(uint16_t holdMs)
+		{
+			const auto lock = LockTimer();
+			const GestureID gesture = NextGestureID();
+			fHolds.insert(std::upper_bound(fHolds.begin(), fHolds.end(), ToTicks(holdMs), [](uint64_t time, const Threshold& threshold) { return time < threshold.time; })
+				, Threshold{ gesture, ToTicks(holdMs) });
+			return gesture;
+		}
+
+		/// <summary>
+		/// Button pressed and released within 'maxDurationMs'.
+		/// </summary>
+		GestureID AddClick(uint16_t maxDurationMs)
+		{
+			const auto lock = LockTimer();
+			const GestureID gesture = NextGestureID();
+			fClicks.insert(std::upper_bound(fClicks.begin(), fClicks.end(), ToTicks(maxDurationMs), [](uint64_t time, const Threshold& threshold) { return time < threshold.time; })
+				, Threshold{ gesture, ToTicks(maxDurationMs) });
+			return gesture;
+		}
+
+		/// <summary>
+		/// All of 'buttons' held together, pressed within 'windowMs' of each other.
+		/// </summary>
+		GestureID AddChord(const std::vector<button_type>& buttons, uint16_t windowMs)
+		{
+			const auto lock = LockTimer();
+			if (buttons.size() < 2)
+				LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "A chord requires at least two buttons");
+
+			const GestureID gesture = NextGestureID();
+			const uint16_t chordIndex = static_cast<uint16_t>(fChords.size());
+			fChords.push_back({ gesture, buttons, ToTicks(windowMs), false });
+			for (const button_type button : buttons)
+				GetButtonData(button).chords.push_back(chordIndex);
+
+			return gesture;
+		}
+
+		uint16_t GetID() const { return fID; }
+
+		void SetButtonState(button_type button, ButtonState newState, SteadyClock::tick_type timeStamp = TimeStampNow) override
+		{
+			const auto lock = LockTimer();
+			ButtonData& buttonData = GetButtonData(button);
+			const SteadyClock::tick_type currentTimeStamp = timeStamp != TimeStampNow ? timeStamp : clock_type::Now();
+
+			if (newState == ButtonState::Down && buttonData.down == false)
+				OnButtonDown(buttonData, currentTimeStamp);
+			else if (newState == ButtonState::Up && buttonData.down == true)
+				OnButtonUp(buttonData, currentTimeStamp);
+		}
+
+		SteadyClock::tick_type NextDeadline() const override
+		{
+			const auto lock = LockTimer();
+			return fDeadline;
+		}
+
+		void Advance(SteadyClock::tick_type now) override
+		{
+			const auto lock = LockTimer();
+			if (now < fDeadline)
+				return;
+
+			fDeadline = SteadyClock::NoDeadline;
+			while (fDeadlines.empty() == false && fDeadlines.top().deadline <= now)
+				OnTimeout(fDeadlines.top());
+
+			if (fDeadlines.empty() == false)
+				ScheduleDeadline(fDeadlines.top().deadline);
+		}
+
+	private:
+		enum class Phase : uint8_t
+		{
+			  Idle
+			, Pressed	// Deadline is the next hold threshold.
+			, Released	// Deadline is the end of the window for the next tap.
+		};
+
+		struct ButtonData : DeadlineHeapNode<ButtonData>
+		{
+			button_type button{};
+			Phase phase = Phase::Idle;
+			bool down = false;
+			/// <summary>
+			/// Index of the next hold threshold while pressed, non zero once a hold was recognized.
+			/// </summary>
+			size_t holdIndex = 0;
+			uint16_t tapCount = 0;
+			uint64_t downTimeStamp = 0;
+			/// <summary>
+			/// Indices of the chords the button is a member of.
+			/// </summary>
+			std::vector<uint16_t> chords;
+		};
+
+		struct Threshold
+		{
+			GestureID gesture;
+			uint64_t time;
+		};
+
+		struct Tap
+		{
+			GestureID gesture;
+			uint16_t taps;
+			uint64_t window;
+		};
+
+		/// <summary>
+		/// Compiled transition data of a tap count.
+		/// </summary>
+		struct TapState
+		{
+			/// <summary>
+			/// Tap gesture completed at this count, NoGesture if none.
+			/// </summary>
+			GestureID gesture = NoGesture;
+			/// <summary>
+			/// How long to wait for another tap, 0 if no gesture has more taps and the sequence ends on release.
+			/// </summary>
+			uint64_t window = 0;
+		};
+
+		struct Chord
+		{
+			GestureID gesture;
+			std::vector<button_type> buttons;
+			uint64_t window;
+			/// <summary>
+			/// Set once recognized, until one of the buttons is released.
+			/// </summary>
+			bool recognized;
+		};
+
+		ButtonData& GetButtonData(button_type buttonId)
+		{
+			return fButtonsData.Get(buttonId);
+		}
+
+		void OnButtonDown(ButtonData& buttonData, SteadyClock::tick_type timeStamp)
+		{
+			buttonData.down = true;
+			buttonData.downTimeStamp = timeStamp;
+			buttonData.tapCount = buttonData.phase == Phase::Released ? buttonData.tapCount + 1 : 1;
+			buttonData.phase = Phase::Pressed;
+			buttonData.holdIndex = 0;
+
+			if (fHolds.empty() == false)
+				SetDeadline(buttonData, timeStamp + fHolds.front().time);
+			else
+				fDeadlines.erase(buttonData);
+
+			for (const uint16_t chordIndex : buttonData.chords)
+				EvaluateChord(fChords[chordIndex], buttonData, timeStamp);
+		}
+
+		void OnButtonUp(ButtonData& buttonData, SteadyClock::tick_type timeStamp)
+		{
+			buttonData.down = false;
+			for (const uint16_t chordIndex : buttonData.chords)
+				fChords[chordIndex].recognized = false;
+
+			const uint64_t duration = timeStamp - buttonData.downTimeStamp;
+			const bool held = buttonData.holdIndex != 0;
+			const uint16_t tapCount = buttonData.tapCount;
+			const TapState* tapState = !held && tapCount < fTapTable.size() ? &fTapTable[tapCount] : nullptr;
+
+			if (tapState != nullptr && tapState->window != 0)
+			{
+				buttonData.phase = Phase::Released;
+				SetDeadline(buttonData, timeStamp + tapState->window);
+			}
+			else
+			{
+				buttonData.phase = Phase::Idle;
+				buttonData.tapCount = 0;
+				fDeadlines.erase(buttonData);
+			}
+
+			// Clicks are sorted by duration, the matching ones are at the end.
+			for (auto it = fClicks.rbegin(); it != fClicks.rend() && it->time >= duration; ++it)
+				Raise(it->gesture, GestureType::Click, buttonData.button, tapCount, timeStamp);
+
+			if (tapState != nullptr && tapState->window == 0 && tapState->gesture != NoGesture)
+				Raise(tapState->gesture, GestureType::Tap, buttonData.button, tapCount, timeStamp);
+		}
+
+		void OnTimeout(ButtonData& buttonData)
+		{
+			const SteadyClock::tick_type timeStamp = buttonData.deadline;
+			if (buttonData.phase == Phase::Pressed)
+			{
+				const Threshold& hold = fHolds[buttonData.holdIndex++];
+				if (buttonData.holdIndex < fHolds.size())
+					SetDeadline(buttonData, buttonData.downTimeStamp + fHolds[buttonData.holdIndex].time);
+				else
+					fDeadlines.erase(buttonData);
+
+				Raise(hold.gesture, GestureType::Hold, buttonData.button, buttonData.tapCount, timeStamp);
+			}
+			else
+			{
+				const uint16_t tapCount = buttonData.tapCount;
+				buttonData.phase = Phase::Idle;
+				buttonData.tapCount = 0;
+				fDeadlines.erase(buttonData);
+
+				const GestureID gesture = fTapTable[tapCount].gesture;
+				if (gesture != NoGesture)
+					Raise(gesture, GestureType::Tap, buttonData.button, tapCount, timeStamp);
+			}
+		}
+
+		void EvaluateChord(Chord& chord, ButtonData& buttonData, SteadyClock::tick_type timeStamp)
+		{
+			if (chord.recognized)
+				return;
+
+			for (const button_type button : chord.buttons)
+			{
+				const ButtonData& member = GetButtonData(button);
+				if (member.down == false || timeStamp - member.downTimeStamp > chord.window)
+					return;
+			}
+
+			chord.recognized = true;
+			Raise(chord.gesture, GestureType::Chord, buttonData.button, buttonData.tapCount, timeStamp);
+		}
+
+		/// <summary>
+		/// Builds the per tap count table from the declared tap gestures.
+		/// </summary>
+		void CompileTaps()
+		{
+			uint16_t maxTaps = 0;
+			for (const Tap& tap : fTaps)
+				maxTaps = (std::max)(maxTaps, tap.taps);
+
+			fTapTable.assign(static_cast<size_t>(maxTaps) + 1, TapState{});
+			for (const Tap& tap : fTaps)
+			{
+				fTapTable[tap.taps].gesture = tap.gesture;
+				// Every shorter sequence has to wait for the next tap of this gesture.
+				for (uint16_t count = 1; count < tap.taps; count++)
+					fTapTable[count].window = (std::max)(fTapTable[count].window, tap.window);
+			}
+		}
+
+		void Raise(GestureID gesture, GestureType type, button_type button, uint16_t tapCount, SteadyClock::tick_type timeStamp)
+		{
+			OnGesture.Raise(GestureEvent{ this, gesture, type, button, tapCount, timeStamp });
+		}
+
+		GestureID NextGestureID()
+		{
+			if (fNextGestureID == NoGesture)
+				LL_EXCEPTION(LLUtils::Exception::ErrorCode::LogicError, "Too many gestures");
+
+			return fNextGestureID++;
+		}
+
+		static uint64_t ToTicks(uint16_t milliseconds)
+		{
+			return milliseconds * SteadyClock::TicksPerMillisecond;
+		}
+
+		void SetDeadline(ButtonData& buttonData, SteadyClock::tick_type deadline)
+		{
+			fDeadlines.push(buttonData, deadline);
+			ScheduleDeadline(deadline);
+		}
+
+		/// <summary>
+		/// Serializes with the timer callback in TimingMode::TimerService, an empty lock in TimingMode::Host.
+		/// </summary>
+		std::unique_lock<std::recursive_mutex> LockTimer() const
+		{
+			return fTimer != nullptr ? fTimer->Lock() : std::unique_lock<std::recursive_mutex>();
+		}
+
+		/// <summary>
+		/// Moves the pending deadline to 'deadline' if it's earlier.
+		/// </summary>
+		void ScheduleDeadline(SteadyClock::tick_type deadline)
+		{
+			if (deadline >= fDeadline)
+				return;
+
+			fDeadline = deadline;
+			if (fTimer != nullptr)
+				ArmTimer(deadline, clock_type::Now());
+		}
+
+		/// <summary>
+		/// Translates 'deadline' from clock_type to the TimerService clock.
+		/// </summary>
+		void ArmTimer(SteadyClock::tick_type deadline, SteadyClock::tick_type now)
+		{
+			fTimer->ScheduleAt(SteadyClock::Now() + (deadline > now ? deadline - now : 0));
+		}
+
+		void TimerCallback()
+		{
+			const SteadyClock::tick_type now = clock_type::Now();
+			if (now < fDeadline && fDeadline != SteadyClock::NoDeadline)
+				ArmTimer(fDeadline, now); // clock_type runs behind the service clock.
+			else
+				Advance(now);
+		}
+
+		uint16_t fID = 0;
+		GestureID fNextGestureID = 0;
+		std::vector<Tap> fTaps;
+		/// <summary>
+		/// Indexed by tap count.
+		/// </summary>
+		std::vector<TapState> fTapTable;
+		/// <summary>
+		/// Sorted by time.
+		/// </summary>
+		std::vector<Threshold> fHolds;
+		/// <summary>
+		/// Sorted by maximum duration.
+		/// </summary>
+		std::vector<Threshold> fClicks;
+		std::vector<Chord> fChords;
+		/// <summary>
+		/// Time the timer is armed for, may be earlier than the earliest button deadline.
+		/// </summary>
+		SteadyClock::tick_type fDeadline = SteadyClock::NoDeadline;
+		ButtonDataStorage<button_type, ButtonData, NUM_BUTTONS> fButtonsData;
+		/// <summary>
+		/// Buttons with a pending hold threshold or tap window, ordered by deadline.
+		/// </summary>
+		DeadlineHeap<ButtonData> fDeadlines;
+		/// <summary>
+		/// Null in TimingMode::Host. Declared last so it's cancelled before the state its callback uses is destroyed.
+		/// </summary>
+		std::unique_ptr<TimerService::Timer> fTimer;
+	};
+}
@@ -23,31 +23,38 @@ SOFTWARE.
 
 #pragma once
 #include <cstdint>
+#include <memory>
+#include <mutex>
 #include <vector>
-#include <map>
-#include <set>
-#include <LLUtils/StopWatch.h>
 #include <LLUtils/Event.h>
 #include <LInput/Buttons/ButtonState.h>
 #include <LInput/Buttons/IButtonStateExtension.h>
-#include <Win32/HighPrecisionTimer.h>
+#include <LInput/Buttons/Extensions/ButtonDataStorage.h>
+#include <LInput/Timing/Clock.h>
+#include <LInput/Timing/TimerService.h>
 
 
 namespace LInput
 {
 
-	template <typename button_type>
+	/// <summary>
+	/// NUM_BUTTONS - number of buttons when bounded, per button data is then kept in a flat array, 0 - unbounded, data is kept in a map.
+	/// clock_type - clock policy timestamps and deadlines are taken from, see SteadyClock.
+	/// In TimingMode::TimerService the methods are serialized with the timer callback by the TimerService lock and events are raised while
+	/// it's held, handlers must not wait for another thread that schedules timers.
+	/// </summary>
+	template <typename button_type, size_t NUM_BUTTONS = 0, typename clock_type = SteadyClock>
 	class MultitapExtension final : public IButtonStateExtension<button_type>
 	{
 	public:
 
-		MultitapExtension(uint16_t id, uint16_t multipressRate, uint16_t maxTaps) :
+		MultitapExtension(uint16_t id, uint16_t multipressRate, uint16_t maxTaps, TimingMode timingMode = TimingMode::TimerService) :
 			fID(id)
 			, fMultiPressThreshold(multipressRate)
 			, fMaxTaps(maxTaps)
 		{
-			fTimer.SetDueTime(multipressRate);
-			fTimer.SetRepeatInterval(INFINITE);
+			if (timingMode == TimingMode::TimerService)
+				fTimer = std::make_unique<TimerService::Timer>([this] { TimerCallback(); });
 		}
 
 		struct MultiTapEvent
@@ -58,13 +65,18 @@ namespace LInput
 			MultitapExtension* parent;
 			button_type button;
 			uint16_t tapCount;
+			/// <summary>
+			/// Capture time of the last tap in nanoseconds on clock_type.
+			/// </summary>
+			uint64_t timeStamp;
 		};
 
 		LLUtils::Event<void(const MultiTapEvent&)> OnButtonEvent;
 		using ListButtonEvent = std::vector<MultiTapEvent>;
 	
-		struct ButtonData
+		struct ButtonData : ButtonListNode<ButtonData>
 		{
+			button_type button{};
 			uint64_t timestampLastButtonDown = 0;
 			uint16_t tapCounter = 0;
 			ButtonState buttonState = ButtonState::Up;
@@ -73,67 +85,66 @@ namespace LInput
 
 		ButtonData& GetButtonData(button_type buttonId)
 		{
-			auto it = fMapButttons.find(buttonId);
-			if (it == fMapButttons.end())
-				it = fMapButttons.emplace(buttonId, ButtonData{}).first;
-
-			return it->second;
+			return fButtonsData.Get(buttonId);
 		}
 
 
-		void ProcessQueuedButtons()
+		/// <summary>
+		/// Raises the multitap events whose window has elapsed by 'now', returns the time the next window elapses.
+		/// Expired taps are popped off the front of the queue, only expired buttons are visited.
+		/// </summary>
+		SteadyClock::tick_type ProcessQueuedButtons(SteadyClock::tick_type now)
 		{
-
-			std::set<button_type> buttonsRemoved;
-	
-			int64_t minTimeToEvent = (std::numeric_limits<int64_t>::min)();
-			for (auto& button : fPressedButtons)
+			const auto lock = LockTimer();
+			while (fPressedButtons.empty() == false)
 			{
-				auto& buttonData = GetButtonData(button);
-				uint64_t now = static_cast<uint64_t>(fStopWatch.GetElapsedTimeInteger(LLUtils::StopWatch::Milliseconds));
-
-				int64_t timeSinceActuation = static_cast<int64_t>(now) - static_cast<int64_t>( buttonData.timestampLastButtonDown);
-
-				int64_t timeToEvent = timeSinceActuation - fMultiPressThreshold;
-				if (timeToEvent >= 0)
-				{ 
-					OnButtonEvent.Raise(MultiTapEvent{ this,button, buttonData.tapCounter });
-					buttonData.tapCounter = 0;
-					buttonsRemoved.insert(button);
-
-				}
-				else
-				{
-					
-					// timeToEvent is negative, get the closest number to zero.
-					minTimeToEvent = (std::max)(minTimeToEvent, timeToEvent);
-				}
+				ButtonData& buttonData = *fPressedButtons.front();
+				if (now < GetEventTime(buttonData))
+					return GetEventTime(buttonData);
+
+				const uint16_t tapCount = buttonData.tapCounter;
+				buttonData.tapCounter = 0;
+				fPressedButtons.erase(buttonData);
+				OnButtonEvent.Raise(MultiTapEvent{ this,buttonData.button, tapCount, buttonData.timestampLastButtonDown });
 			}
 
-			if (minTimeToEvent != (std::numeric_limits<int64_t>::min)())
-			{
-				fTimer.SetDueTime(static_cast<DWORD>( -minTimeToEvent));
-				fTimer.Enable(true);
-			}
+			return SteadyClock::NoDeadline;
+		}
 
-			for (const auto& remove : buttonsRemoved)
-				fPressedButtons.erase(remove);
+		void TimerCallback()
+		{
+			const SteadyClock::tick_type now = clock_type::Now();
+			if (now < fDeadline && fDeadline != SteadyClock::NoDeadline)
+				ArmTimer(fDeadline, now); // clock_type runs behind the service clock.
+			else
+				Advance(now);
+		}
 
+		SteadyClock::tick_type NextDeadline() const override
+		{
+			const auto lock = LockTimer();
+			return fDeadline;
 		}
 
-		void TimerCallback()
+		void Advance(SteadyClock::tick_type now) override
 		{
-			ProcessQueuedButtons();
+			const auto lock = LockTimer();
+			if (now < fDeadline)
+				return;
+
+			fDeadline = SteadyClock::NoDeadline;
+			ScheduleDeadline(ProcessQueuedButtons(now));
 		}
 
 	public:
 
 		uint16_t GetID() const { return fID; }
 		// Get the state of a button whether it's down or up
-		void SetButtonState(button_type button, ButtonState newState) override
+		void SetButtonState(button_type button, ButtonState newState, SteadyClock::tick_type timeStamp = TimeStampNow) override
 		{
+			const auto lock = LockTimer();
 			ButtonData& buttonData = GetButtonData(button);
-			const uint64_t currentTimeStamp = static_cast<uint64_t>(fStopWatch.GetElapsedTimeInteger(LLUtils::StopWatch::Milliseconds));
+			const uint64_t currentTimeStamp = timeStamp != TimeStampNow ? timeStamp : clock_type::Now();
 
 			if (buttonData.buttonState != newState)
 			{
@@ -148,19 +159,18 @@ namespace LInput
 
 						if (buttonData.tapCounter < fMaxTaps)
 						{
-							fPressedButtons.insert(button);
-							fTimer.SetDueTime(fMultiPressThreshold);
-							fTimer.Enable(true);
+							fPressedButtons.push_back(buttonData);
+							ScheduleDeadline(GetEventTime(buttonData));
 						}
 						else if (buttonData.tapCounter == fMaxTaps) // reached max taps, raise an event
 						{
-							fPressedButtons.erase(button);
+							fPressedButtons.erase(buttonData);
 							
-							OnButtonEvent.Raise(MultiTapEvent{ this,button, buttonData.tapCounter });
+							OnButtonEvent.Raise(MultiTapEvent{ this,button, buttonData.tapCounter, currentTimeStamp });
 							buttonData.tapCounter = 0;
 							if (fPressedButtons.empty() == true)
 							{
-								fTimer.Enable(false);
+								CancelDeadline();
 							}
 						}
 					}
@@ -173,6 +183,49 @@ namespace LInput
 		}
 	private:
 
+		/// <summary>
+		/// Time the multitap window of 'buttonData' elapses.
+		/// </summary>
+		SteadyClock::tick_type GetEventTime(const ButtonData& buttonData) const
+		{
+			return buttonData.timestampLastButtonDown + fMultiPressThreshold * SteadyClock::TicksPerMillisecond;
+		}
+
+		/// <summary>
+		/// Serializes with the timer callback in TimingMode::TimerService, an empty lock in TimingMode::Host.
+		/// </summary>
+		std::unique_lock<std::recursive_mutex> LockTimer() const
+		{
+			return fTimer != nullptr ? fTimer->Lock() : std::unique_lock<std::recursive_mutex>();
+		}
+
+		/// <summary>
+		/// Moves the pending deadline to 'deadline' if it's earlier.
+		/// </summary>
+		void ScheduleDeadline(SteadyClock::tick_type deadline)
+		{
+			if (deadline >= fDeadline)
+				return;
+
+			fDeadline = deadline;
+			if (fTimer != nullptr)
+				ArmTimer(deadline, clock_type::Now());
+		}
+
+		/// <summary>
+		/// Translates 'deadline' from clock_type to the TimerService clock.
+		/// </summary>
+		void ArmTimer(SteadyClock::tick_type deadline, SteadyClock::tick_type now)
+		{
+			fTimer->ScheduleAt(SteadyClock::Now() + (deadline > now ? deadline - now : 0));
+		}
+
+		void CancelDeadline()
+		{
+			fDeadline = SteadyClock::NoDeadline;
+			if (fTimer != nullptr)
+				fTimer->Cancel();
+		}
 	
 		uint16_t fID = 0;
 		/// <summary>
@@ -183,15 +236,20 @@ namespace LInput
 		/// the repeat rate in milliseconds, set to zero (0) to disable repeat rate
 		/// </summary>
 		uint16_t fMaxTaps = 3;
-	
-		::Win32::HighPrecisionTimer fTimer = ::Win32::HighPrecisionTimer(std::bind(&MultitapExtension::TimerCallback, this));
+		/// <summary>
+		/// Time the earliest pending multitap window elapses, SteadyClock::NoDeadline if none is pending.
+		/// </summary>
+		SteadyClock::tick_type fDeadline = SteadyClock::NoDeadline;
 
-		using MapButtonToData = std::map<button_type, ButtonData>;
-		MapButtonToData fMapButttons;
+		ButtonDataStorage<button_type, ButtonData, NUM_BUTTONS> fButtonsData;
+		/// <summary>
+		/// Buttons with an open multitap window, in the order of their last tap.
+		/// All windows have the same length so the front always expires first, a tap moves its button to the back.
+		/// </summary>
+		ButtonList<ButtonData> fPressedButtons;
 		/// <summary>
-		/// used for sending key repeaet signals to the client
+		/// Null in TimingMode::Host. Declared last so it's cancelled before the state its callback uses is destroyed.
 		/// </summary>
-		std::set<button_type> fPressedButtons;
-		LLUtils::StopWatch fStopWatch = LLUtils::StopWatch(true);
+		std::unique_ptr<TimerService::Timer> fTimer;
 	};
 }
\ No newline at end of file
@@ -22,20 +22,47 @@ SOFTWARE.
 
 #pragma once
 #include <cstdint>
+#include <cstddef>
 #include "ButtonState.h"
+#include <LInput/Timing/Clock.h>
 namespace LInput
 {
 
+	/// <summary>
+	/// Number of distinct values of T, e.g. 256 for uint8_t.
+	/// </summary>
 	template <typename T>
-	constexpr size_t MaxValue = (1 << (sizeof(T) * 8 - 1)) | (sizeof(T) * 8 - 1);
+	constexpr size_t MaxValue = size_t{ 1 } << (sizeof(T) * 8);
 
 
+	/// <summary>
+	/// How an extension handles its deadlines, e.g. key repeats and multitap windows.
+	/// TimerService - deadlines fire on the shared TimerService thread.
+	/// Host - opt-in single threaded mode, the host folds NextDeadline into its own loop and calls Advance,
+	/// deadlines then fire on the host thread with no locks involved.
+	/// </summary>
+	enum class TimingMode { TimerService, Host };
+
 	template <typename button_type>
 	
 	class IButtonStateExtension
 	{
 	public:
-		virtual void SetButtonState(button_type button, ButtonState state) = 0;
+		/// <summary>
+		/// 'timeStamp' - the time the transition was captured in nanoseconds on the extension's clock, TimeStampNow to read the clock.
+		/// </summary>
+		virtual void SetButtonState(button_type button, ButtonState state, SteadyClock::tick_type timeStamp = TimeStampNow) = 0;
+
+		/// <summary>
+		/// The time, on the extension's clock, at which Advance should next be called, SteadyClock::NoDeadline if there's nothing pending.
+		/// </summary>
+		virtual SteadyClock::tick_type NextDeadline() const { return SteadyClock::NoDeadline; }
+
+		/// <summary>
+		/// Processes every deadline up to and including 'now'.
+		/// </summary>
+		virtual void Advance([[maybe_unused]] SteadyClock::tick_type now) {}
+
 		virtual ~IButtonStateExtension(){}
 	};
 }
\ No newline at end of file
@@ -21,6 +21,7 @@ SOFTWARE.
 */
 
 #pragma once
+#include <cstddef>
 #include <cstdint>
 #include <LInput/Buttons/ButtonType.h>
 namespace LInput
@@ -0,0 +1,303 @@
+/*
+Copyright (c) 2020 Lior Lahav
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include <LInput/Keys/Span.h>
+#include "HidReportDescriptor.h"
+#include "HidReportFilter.h"
+
+namespace LInput
+{
+    /// <summary>
+    /// State of a gamepad, joystick or any other HID device, sized from the device capabilities when the device arrives.
+    /// Buttons are a bit mask of any width, bit i of word i / 32 is button i.
+    /// Values are kept as structure of arrays: the raw logical value and the value normalized from [logicalMin, logicalMax]
+    /// to [-32768, 32767], e.g. a centered stick is about 0 and a released trigger is -32768.
+    /// Every update records what changed since the previous one: the toggled buttons and the axes that moved by more than their epsilon.
+    /// Updating the state doesn't allocate.
+    /// </summary>
+    class GamepadState
+    {
+    public:
+        static constexpr size_t NoAxis = (std::numeric_limits<size_t>::max)();
+
+        GamepadState() = default;
+
+        GamepadState(size_t buttonCount, std::vector<HidValueInfo> axes, bool usesReportIds = false) :
+              fButtonCount(buttonCount)
+            , fButtonWords((buttonCount + 31) / 32)
+            , fPreviousButtonWords(fButtonWords.size())
+            , fChangedButtonWords(fButtonWords.size())
+            , fAxisInfo(std::move(axes))
+            , fAxes(fAxisInfo.size())
+            , fRawValues(fAxisInfo.size())
+            , fAxisMin(fAxisInfo.size())
+            , fAxisScale(fAxisInfo.size())
+            , fAxisEpsilon(fAxisInfo.size())
+            , fReportedAxes(fAxisInfo.size())
+            , fReportedRawValues(fAxisInfo.size())
+            , fReportFilter(usesReportIds)
+        {
+            fChangedAxes.reserve(fAxisInfo.size());
+            for (size_t i = 0; i < fAxisInfo.size(); i++)
+            {
+                HidValueInfo& info = fAxisInfo[i];
+                // An inverted range the descriptor quirks couldn't repair becomes degenerate, Normalize relies on min <= max.
+                if (info.logicalMax < info.logicalMin)
+                    info.logicalMax = info.logicalMin;
+
+                const uint64_t range = info.logicalMax > info.logicalMin ? static_cast<uint64_t>(static_cast<int64_t>(info.logicalMax) - info.logicalMin) : 0;
+                fAxisMin[i] = info.logicalMin;
+                // 16.16 fixed point rounded up so the logical maximum reaches 32767, 0 maps every value of a degenerate range to the minimum.
+                fAxisScale[i] = range != 0 ? ((uint64_t{ UINT16_MAX } << 16) + range - 1) / range : 0;
+            }
+        }
+
+        explicit GamepadState(const HidDeviceLayout& layout) : GamepadState(layout.GetButtonCount(), GetValueInfos(layout), layout.UsesReportIds()) {}
+
+        /// <summary>
+        /// Decodes an input report of a device with the layout the state was created from.
+        /// Reports identical to the previous one are dropped before decoding.
+        /// Returns true if any button or axis changed, see GetChangedButtonWord and GetChangedAxes.
+        /// </summary>
+        bool Update(const HidDeviceLayout& layout, const uint8_t* report, size_t size)
+        {
+            if (ReportChanged(report, size) == false || layout.Decode(report, size, fButtonWords.data(), fRawValues.data()) == false)
+                return false;
+
+            for (size_t i = 0; i < fRawValues.size(); i++)
+                fAxes[i] = Normalize(i, fRawValues[i]);
+
+            return CommitChanges();
+        }
+
+        /// <summary>
+        /// False if 'report' is identical to the previous report, for states updated with SetButton and SetRawValue
+        /// the report can be dropped before it's decoded.
+        /// </summary>
+        bool ReportChanged(const uint8_t* report, size_t size)
+        {
+            return fReportFilter.Changed(report, size);
+        }
+
+        /// <summary>
+        /// Records the changes since the previous commit, call after updating the state with SetButton and SetRawValue.
+        /// Returns true if any button or axis changed.
+        /// </summary>
+        bool CommitChanges()
+        {
+            uint32_t anyButton = 0;
+            for (size_t word = 0; word < fButtonWords.size(); word++)
+            {
+                fChangedButtonWords[word] = fButtonWords[word] ^ fPreviousButtonWords[word];
+                fPreviousButtonWords[word] = fButtonWords[word];
+                anyButton |= fChangedButtonWords[word];
+            }
+
+            // Axes are compared to the value last reported so slow drifts still show once they exceed the epsilon.
+            // Out of range values, e.g. the null state of a hat switch, clamp to the range and are compared raw.
+            fChangedAxes.clear();
+            for (size_t i = 0; i < fAxes.size(); i++)
+            {
+                const int32_t delta = static_cast<int32_t>(fAxes[i]) - fReportedAxes[i];
+                const bool nullState = IsNullState(i, fRawValues[i]);
+                const bool nullStateChanged = nullState != IsNullState(i, fReportedRawValues[i]) || (nullState && fRawValues[i] != fReportedRawValues[i]);
+                if (nullStateChanged || (delta != 0 && static_cast<uint32_t>(delta < 0 ? -delta : delta) > fAxisEpsilon[i]))
+                {
+                    fReportedAxes[i] = fAxes[i];
+                    fReportedRawValues[i] = fRawValues[i];
+                    fChangedAxes.push_back(static_cast<uint16_t>(i));
+                }
+            }
+
+            return anyButton != 0 || fChangedAxes.empty() == false;
+        }
+
+        /// <summary>
+        /// Buttons in 'word' that toggled in the last update that reported changes.
+        /// </summary>
+        uint32_t GetChangedButtonWord(size_t word) const
+        {
+            return fChangedButtonWords[word];
+        }
+
+        /// <summary>
+        /// Indices of the axes that changed in the last update that reported changes.
+        /// </summary>
+        Span<const uint16_t> GetChangedAxes() const
+        {
+            return Span<const uint16_t>(fChangedAxes.data(), fChangedAxes.size());
+        }
+
+        /// <summary>
+        /// Normalized distance an axis must move before it's reported as changed, 0 reports any change.
+        /// </summary>
+        void SetAxisEpsilon(size_t axis, uint16_t epsilon)
+        {
+            fAxisEpsilon[axis] = epsilon;
+        }
+
+        void SetAxisEpsilon(uint16_t epsilon)
+        {
+            std::fill(fAxisEpsilon.begin(), fAxisEpsilon.end(), epsilon);
+        }
+
+        size_t GetButtonCount() const
+        {
+            return fButtonCount;
+        }
+
+        size_t GetButtonWordCount() const
+        {
+            return fButtonWords.size();
+        }
+
+        uint32_t GetButtonWord(size_t word) const
+        {
+            return fButtonWords[word];
+        }
+
+        /// <summary>
+        /// Mask of the buttons the device has in 'word'.
+        /// </summary>
+        uint32_t GetButtonValidWord(size_t word) const
+        {
+            const size_t buttons = fButtonCount - word * 32;
+            return buttons >= 32 ? UINT32_MAX : (uint32_t{ 1 } << buttons) - 1;
+        }
+
+        bool IsButtonDown(size_t button) const
+        {
+            return button < fButtonCount && (fButtonWords[button / 32] & (uint32_t{ 1 } << (button % 32))) != 0;
+        }
+
+        void ClearButtons()
+        {
+            std::fill(fButtonWords.begin(), fButtonWords.end(), 0u);
+        }
+
+        void SetButton(size_t button, bool down)
+        {
+            if (button >= fButtonCount)
+                return;
+
+            const uint32_t bit = uint32_t{ 1 } << (button % 32);
+            uint32_t& word = fButtonWords[button / 32];
+            word = down ? word | bit : word & ~bit;
+        }
+
+        size_t GetAxisCount() const
+        {
+            return fAxes.size();
+        }
+
+        const HidValueInfo& GetAxisInfo(size_t axis) const
+        {
+            return fAxisInfo[axis];
+        }
+
+        /// <summary>
+        /// Index of the axis with the given usage, e.g. (GenericDesktop, 0x30) for X, NoAxis if the device has none.
+        /// </summary>
+        size_t FindAxis(HidUsagePage usagePage, uint16_t usage) const
+        {
+            for (size_t i = 0; i < fAxisInfo.size(); i++)
+                if (fAxisInfo[i].usagePage == static_cast<uint16_t>(usagePage) && fAxisInfo[i].usage == usage)
+                    return i;
+            return NoAxis;
+        }
+
+        const int16_t* GetAxes() const
+        {
+            return fAxes.data();
+        }
+
+        int16_t GetAxis(size_t axis) const
+        {
+            return fAxes[axis];
+        }
+
+        /// <summary>
+        /// The normalized value in [-1, 1].
+        /// </summary>
+        float GetAxisFloat(size_t axis) const
+        {
+            return fAxes[axis] < 0 ? fAxes[axis] / 32768.0f : fAxes[axis] / 32767.0f;
+        }
+
+        /// <summary>
+        /// The logical value, e.g. the direction of a hat switch, values outside the logical range report a null state.
+        /// </summary>
+        int32_t GetRawValue(size_t axis) const
+        {
+            return fRawValues[axis];
+        }
+
+        void SetRawValue(size_t axis, int32_t value)
+        {
+            fRawValues[axis] = value;
+            fAxes[axis] = Normalize(axis, value);
+        }
+
+    private:
+        static std::vector<HidValueInfo> GetValueInfos(const HidDeviceLayout& layout)
+        {
+            std::vector<HidValueInfo> values;
+            values.reserve(layout.GetValueCount());
+            for (size_t i = 0; i < layout.GetValueCount(); i++)
+                values.push_back(layout.GetValueInfo(i));
+            return values;
+        }
+
+        bool IsNullState(size_t axis, int32_t value) const
+        {
+            return value < fAxisInfo[axis].logicalMin || value > fAxisInfo[axis].logicalMax;
+        }
+
+        int16_t Normalize(size_t axis, int32_t value) const
+        {
+            const int64_t offset = std::clamp(static_cast<int64_t>(value) - fAxisMin[axis], int64_t{ 0 }, static_cast<int64_t>(fAxisInfo[axis].logicalMax) - fAxisMin[axis]);
+            const uint64_t scaled = (std::min)((static_cast<uint64_t>(offset) * fAxisScale[axis]) >> 16, uint64_t{ UINT16_MAX });
+            return static_cast<int16_t>(static_cast<int64_t>(scaled) + INT16_MIN);
+        }
+
+        size_t fButtonCount = 0;
+        std::vector<uint32_t> fButtonWords;
+        std::vector<uint32_t> fPreviousButtonWords;
+        std::vector<uint32_t> fChangedButtonWords;
+        std::vector<HidValueInfo> fAxisInfo;
+        std::vector<int16_t> fAxes;
+        std::vector<int32_t> fRawValues;
+        std::vector<int32_t> fAxisMin;
+        std::vector<uint64_t> fAxisScale;
+        std::vector<uint16_t> fAxisEpsilon;
+        std::vector<int16_t> fReportedAxes;
+        std::vector<int32_t> fReportedRawValues;
+        std::vector<uint16_t> fChangedAxes;
+        HidReportFilter fReportFilter;
+    };
+}
@@ -0,0 +1,598 @@
+/*
+Copyright (c) 2020 Lior Lahav
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <LLUtils/Exception.h>
+
+namespace LInput
+{
+    /// <summary>
+    /// Usage pages the decoder gives special treatment, see the HID Usage Tables specification.
+    /// </summary>
+    enum class HidUsagePage : uint16_t
+    {
+          GenericDesktop = 0x01
+        , Simulation = 0x02
+        , Keyboard = 0x07
+        , Button = 0x09
+        , VendorDefinedFirst = 0xFF00
+    };
+
+    /// <summary>
+    /// A value field of a device, e.g. an axis or a hat switch.
+    /// </summary>
+    struct HidValueInfo
+    {
+        uint16_t usagePage;
+        uint16_t usage;
+        int32_t logicalMin;
+        int32_t logicalMax;
+        uint8_t bitSize;
+    };
+
+    /// <summary>
+    /// Input report layout of a device compiled from its report descriptor.
+    /// Every input field is resolved to a precomputed byte offset, shift and mask, so decoding a report is straight-line bit extraction
+    /// with no descriptor walking and no allocations.
+    /// Buttons are numbered by their usage on the button page minus one, values in order of first appearance in the descriptor.
+    /// </summary>
+    class HidDeviceLayout
+    {
+    public:
+        size_t GetButtonCount() const
+        {
+            return fButtonCount;
+        }
+
+        /// <summary>
+        /// Number of 32 bit words the button state of the device takes.
+        /// </summary>
+        size_t GetButtonWordCount() const
+        {
+            return (fButtonCount + 31) / 32;
+        }
+
+        size_t GetValueCount() const
+        {
+            return fValues.size();
+        }
+
+        const HidValueInfo& GetValueInfo(size_t index) const
+        {
+            return fValues.at(index);
+        }
+
+        bool UsesReportIds() const
+        {
+            return fUsesReportIds;
+        }
+
+        /// <summary>
+        /// Decodes an input report, including its report ID byte when the device uses report IDs.
+        /// Writes the buttons and values the report carries to 'buttonWords' (GetButtonWordCount() words, bit i is button i)
+        /// and 'values' (GetValueCount() entries), fields of other reports are left untouched.
+        /// Returns false for an unknown report ID or a report shorter than its declared size.
+        /// </summary>
+        bool Decode(const uint8_t* report, size_t size, uint32_t* buttonWords, int32_t* values) const
+        {
+            uint8_t reportId = 0;
+            if (fUsesReportIds)
+            {
+                if (size == 0)
+                    return false;
+                reportId = report[0];
+                report++;
+                size--;
+            }
+
+            const uint8_t reportIndex = fReportIndex[reportId];
+            if (reportIndex == NoReport || size < fReports[reportIndex].sizeBytes)
+                return false;
+
+            const ReportLayout& layout = fReports[reportIndex];
+
+            for (const ButtonRun& run : layout.buttonRuns)
+            {
+                const uint32_t bits = static_cast<uint32_t>((Load(report, size, run.byteOffset) >> run.shift) & run.sourceMask);
+                uint32_t& word = buttonWords[run.word];
+                word = (word & ~(run.sourceMask << run.wordShift)) | (bits << run.wordShift);
+            }
+
+            for (const ValueField& field : layout.values)
+            {
+                const uint32_t raw = static_cast<uint32_t>((Load(report, size, field.byteOffset) >> field.shift) & field.mask);
+                // Sign extension, signBit is 0 for unsigned fields.
+                values[field.index] = static_cast<int32_t>(static_cast<int64_t>(raw ^ field.signBit) - field.signBit);
+            }
+
+            for (const ButtonArray& array : layout.buttonArrays)
+                DecodeButtonArray(array, report, size, buttonWords);
+
+            return true;
+        }
+
+    private:
+        friend class HidReportDescriptor;
+
+        static constexpr uint8_t NoReport = 0xFF;
+
+        /// <summary>
+        /// Consecutive one bit button fields of consecutive buttons that land in the same button word.
+        /// </summary>
+        struct ButtonRun
+        {
+            uint32_t byteOffset;
+            uint8_t shift;
+            uint8_t wordShift;
+            uint16_t word;
+            uint8_t count;
+            uint32_t sourceMask;
+        };
+
+        struct ValueField
+        {
+            uint32_t byteOffset;
+            uint8_t shift;
+            uint16_t index;
+            uint32_t mask;
+            uint32_t signBit;
+        };
+
+        /// <summary>
+        /// An array of button indices, each entry holds the pressed button as an offset from usageMin.
+        /// </summary>
+        struct ButtonArray
+        {
+            uint32_t bitOffset;
+            uint8_t bitSize;
+            uint16_t count;
+            int32_t logicalMin;
+            int32_t logicalMax;
+            uint16_t usageMin;
+            uint16_t usageMax;
+        };
+
+        struct ReportLayout
+        {
+            uint8_t reportId = 0;
+            uint32_t sizeBits = 0;
+            uint32_t sizeBytes = 0;
+            std::vector<ButtonRun> buttonRuns;
+            std::vector<ValueField> values;
+            std::vector<ButtonArray> buttonArrays;
+        };
+
+        /// <summary>
+        /// Little endian load of up to 8 bytes at 'byteOffset', HID reports and all supported targets are little endian.
+        /// </summary>
+        static uint64_t Load(const uint8_t* report, size_t size, uint32_t byteOffset)
+        {
+            uint64_t word = 0;
+            if (byteOffset + sizeof(word) <= size)
+            {
+                std::memcpy(&word, report + byteOffset, sizeof(word));
+            }
+            else
+            {
+                for (size_t i = 0; byteOffset + i < size; i++)
+                    word |= static_cast<uint64_t>(report[byteOffset + i]) << (i * 8);
+            }
+            return word;
+        }
+
+        static void DecodeButtonArray(const ButtonArray& array, const uint8_t* report, size_t size, uint32_t* buttonWords)
+        {
+            for (uint32_t usage = array.usageMin; usage <= array.usageMax; usage++)
+                if (usage != 0)
+                    buttonWords[(usage - 1) / 32] &= ~(uint32_t{ 1 } << ((usage - 1) % 32));
+
+            const uint64_t mask = (uint64_t{ 1 } << array.bitSize) - 1;
+            for (uint32_t i = 0; i < array.count; i++)
+            {
+                const uint32_t bitOffset = array.bitOffset + i * array.bitSize;
+                const int64_t entry = static_cast<int64_t>((Load(report, size, bitOffset / 8) >> (bitOffset % 8)) & mask);
+                if (entry < array.logicalMin || entry > array.logicalMax)
+                    continue; // Out of range entries mean no button.
+
+                const uint32_t usage = array.usageMin + static_cast<uint32_t>(entry - array.logicalMin);
+                if (usage != 0 && usage <= array.usageMax)
+                    buttonWords[(usage - 1) / 32] |= uint32_t{ 1 } << ((usage - 1) % 32);
+            }
+        }
+
+        std::vector<ReportLayout> fReports;
+        std::array<uint8_t, 256> fReportIndex{};
+        std::vector<HidValueInfo> fValues;
+        size_t fButtonCount = 0;
+        bool fUsesReportIds = false;
+    };
+
+    /// <summary>
+    /// Parser of HID report descriptors, compiles the input reports of a device to a HidDeviceLayout once, e.g. on device arrival.
+    /// Output and feature reports, constant (padding) fields, vendor defined pages and fields wider than 32 bits are skipped,
+    /// array fields are decoded on the button page only.
+    /// </summary>
+    class HidReportDescriptor
+    {
+    public:
+        static HidDeviceLayout Compile(const uint8_t* descriptor, size_t size)
+        {
+            HidDeviceLayout layout;
+            layout.fReportIndex.fill(HidDeviceLayout::NoReport);
+
+            GlobalState global;
+            std::vector<GlobalState> globalStack;
+            LocalState local;
+            int collectionDepth = 0;
+
+            for (size_t position = 0; position < size;)
+            {
+                const uint8_t prefix = descriptor[position++];
+                if (prefix == LongItemPrefix)
+                {
+                    // Long items carry no input fields, skip them.
+                    if (position + 2 > size)
+                        LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "truncated HID report descriptor");
+                    position += 2 + descriptor[position];
+                    continue;
+                }
+
+                const size_t dataSize = (prefix & 0x03) == 3 ? 4 : (prefix & 0x03);
+                if (position + dataSize > size)
+                    LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "truncated HID report descriptor");
+
+                uint32_t data = 0;
+                for (size_t i = 0; i < dataSize; i++)
+                    data |= static_cast<uint32_t>(descriptor[position + i]) << (i * 8);
+                position += dataSize;
+
+                const uint8_t type = (prefix >> 2) & 0x03;
+                const uint8_t tag = prefix >> 4;
+                switch (type)
+                {
+                case ItemTypeMain:
+                    switch (tag)
+                    {
+                    case MainInput:
+                        AddInput(layout, global, local, data);
+                        break;
+                    case MainCollection:
+                        collectionDepth++;
+                        break;
+                    case MainEndCollection:
+                        if (--collectionDepth < 0)
+                            LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "unbalanced HID collection");
+                        break;
+                    default:
+                        break;
+                    }
+                    local = LocalState{};
+                    break;
+
+                case ItemTypeGlobal:
+                    switch (tag)
+                    {
+                    case GlobalUsagePage:
+                        global.usagePage = static_cast<uint16_t>(data);
+                        break;
+                    case GlobalLogicalMinimum:
+                        global.logicalMin = SignExtend(data, dataSize);
+                        break;
+                    case GlobalLogicalMaximum:
+                        global.logicalMax = SignExtend(data, dataSize);
+                        global.logicalMaxUnsigned = data;
+                        break;
+                    case GlobalReportSize:
+                        global.reportSize = data;
+                        break;
+                    case GlobalReportId:
+                        if (data == 0 || data > 0xFF)
+                            LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "invalid HID report ID");
+                        global.reportId = static_cast<uint8_t>(data);
+                        layout.fUsesReportIds = true;
+                        break;
+                    case GlobalReportCount:
+                        global.reportCount = data;
+                        break;
+                    case GlobalPush:
+                        globalStack.push_back(global);
+                        break;
+                    case GlobalPop:
+                        if (globalStack.empty())
+                            LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "HID global item pop without push");
+                        global = globalStack.back();
+                        globalStack.pop_back();
+                        break;
+                    default:
+                        break;
+                    }
+                    break;
+
+                case ItemTypeLocal:
+                    switch (tag)
+                    {
+                    case LocalUsage:
+                        local.usages.push_back(ToUsageRange(global, data, dataSize, data, dataSize));
+                        break;
+                    case LocalUsageMinimum:
+                        local.usageMin = data;
+                        local.usageMinSize = dataSize;
+                        local.hasUsageMin = true;
+                        break;
+                    case LocalUsageMaximum:
+                        if (local.hasUsageMin)
+                        {
+                            local.usages.push_back(ToUsageRange(global, local.usageMin, local.usageMinSize, data, dataSize));
+                            local.hasUsageMin = false;
+                        }
+                        break;
+                    default:
+                        break;
+                    }
+                    break;
+
+                default:
+                    break;
+                }
+            }
+
+            if (collectionDepth != 0)
+                LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "unbalanced HID collection");
+
+            for (HidDeviceLayout::ReportLayout& report : layout.fReports)
+                report.sizeBytes = (report.sizeBits + 7) / 8;
+
+            return layout;
+        }
+
+        static HidDeviceLayout Compile(const std::vector<uint8_t>& descriptor)
+        {
+            return Compile(descriptor.data(), descriptor.size());
+        }
+
+    private:
+        static constexpr uint8_t LongItemPrefix = 0xFE;
+
+        static constexpr uint8_t ItemTypeMain = 0;
+        static constexpr uint8_t ItemTypeGlobal = 1;
+        static constexpr uint8_t ItemTypeLocal = 2;
+
+        static constexpr uint8_t MainInput = 0x8;
+        static constexpr uint8_t MainCollection = 0xA;
+        static constexpr uint8_t MainEndCollection = 0xC;
+
+        static constexpr uint8_t GlobalUsagePage = 0x0;
+        static constexpr uint8_t GlobalLogicalMinimum = 0x1;
+        static constexpr uint8_t GlobalLogicalMaximum = 0x2;
+        static constexpr uint8_t GlobalReportSize = 0x7;
+        static constexpr uint8_t GlobalReportId = 0x8;
+        static constexpr uint8_t GlobalReportCount = 0x9;
+        static constexpr uint8_t GlobalPush = 0xA;
+        static constexpr uint8_t GlobalPop = 0xB;
+
+        static constexpr uint8_t LocalUsage = 0x0;
+        static constexpr uint8_t LocalUsageMinimum = 0x1;
+        static constexpr uint8_t LocalUsageMaximum = 0x2;
+
+        static constexpr uint32_t InputConstant = 0x01;
+        static constexpr uint32_t InputVariable = 0x02;
+
+        static constexpr uint32_t MaxFieldBits = 32;
+        static constexpr uint32_t MaxRunButtons = 32;
+
+        struct GlobalState
+        {
+            uint16_t usagePage = 0;
+            int32_t logicalMin = 0;
+            int32_t logicalMax = 0;
+            uint32_t logicalMaxUnsigned = 0;
+            uint32_t reportSize = 0;
+            uint32_t reportCount = 0;
+            uint8_t reportId = 0;
+        };
+
+        struct UsageRange
+        {
+            uint16_t usagePage;
+            uint16_t usageMin;
+            uint16_t usageMax;
+        };
+
+        struct LocalState
+        {
+            std::vector<UsageRange> usages;
+            uint32_t usageMin = 0;
+            size_t usageMinSize = 0;
+            bool hasUsageMin = false;
+        };
+
+        static int32_t SignExtend(uint32_t data, size_t dataSize)
+        {
+            switch (dataSize)
+            {
+            case 1:
+                return static_cast<int8_t>(data);
+            case 2:
+                return static_cast<int16_t>(data);
+            default:
+                return static_cast<int32_t>(data);
+            }
+        }
+
+        /// <summary>
+        /// A 4 byte usage carries its own usage page in the high word.
+        /// </summary>
+        static UsageRange ToUsageRange(const GlobalState& global, uint32_t min, size_t minSize, uint32_t max, size_t maxSize)
+        {
+            const uint16_t usagePage = minSize == 4 ? static_cast<uint16_t>(min >> 16)
+                : maxSize == 4 ? static_cast<uint16_t>(max >> 16)
+                : global.usagePage;
+            const uint16_t usageMin = static_cast<uint16_t>(min);
+            const uint16_t usageMax = static_cast<uint16_t>(max);
+            return UsageRange{ usagePage, usageMin, (std::max)(usageMin, usageMax) };
+        }
+
+        /// <summary>
+        /// Usage of the i-th field of a main item, the last usage repeats for the remaining fields.
+        /// </summary>
+        static bool GetUsage(const LocalState& local, uint32_t i, uint16_t& usagePage, uint16_t& usage)
+        {
+            if (local.usages.empty())
+                return false;
+
+            for (const UsageRange& range : local.usages)
+            {
+                const uint32_t count = static_cast<uint32_t>(range.usageMax - range.usageMin) + 1;
+                if (i < count)
+                {
+                    usagePage = range.usagePage;
+                    usage = static_cast<uint16_t>(range.usageMin + i);
+                    return true;
+                }
+                i -= count;
+            }
+
+            usagePage = local.usages.back().usagePage;
+            usage = local.usages.back().usageMax;
+            return true;
+        }
+
+        static HidDeviceLayout::ReportLayout& GetReport(HidDeviceLayout& layout, uint8_t reportId)
+        {
+            uint8_t& index = layout.fReportIndex[reportId];
+            if (index == HidDeviceLayout::NoReport)
+            {
+                if (layout.fReports.size() >= HidDeviceLayout::NoReport)
+                    LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "too many HID reports");
+                index = static_cast<uint8_t>(layout.fReports.size());
+                layout.fReports.emplace_back().reportId = reportId;
+            }
+            return layout.fReports[index];
+        }
+
+        /// <summary>
+        /// Values are keyed by usage and occurrence within their report, e.g. the X of the second stick of a dual stick pad is the
+        /// second X occurrence. The same occurrence in different reports is a single value, the reports update it in turn.
+        /// </summary>
+        static uint16_t GetValueIndex(HidDeviceLayout& layout, const HidDeviceLayout::ReportLayout& report, const HidValueInfo& info)
+        {
+            const auto sameUsage = [&info](const HidValueInfo& value)
+            {
+                return value.usagePage == info.usagePage && value.usage == info.usage;
+            };
+
+            size_t occurrence = static_cast<size_t>(std::count_if(report.values.begin(), report.values.end(), [&layout, &sameUsage](const HidDeviceLayout::ValueField& field)
+            {
+                return sameUsage(layout.fValues[field.index]);
+            }));
+
+            for (size_t i = 0; i < layout.fValues.size(); i++)
+                if (sameUsage(layout.fValues[i]) && occurrence-- == 0)
+                    return static_cast<uint16_t>(i);
+
+            layout.fValues.push_back(info);
+            return static_cast<uint16_t>(layout.fValues.size() - 1);
+        }
+
+        static void AddButton(HidDeviceLayout& layout, HidDeviceLayout::ReportLayout& report, uint32_t bitOffset, uint16_t usage)
+        {
+            const uint32_t button = static_cast<uint32_t>(usage) - 1;
+            const uint16_t word = static_cast<uint16_t>(button / 32);
+            const uint8_t wordShift = static_cast<uint8_t>(button % 32);
+            layout.fButtonCount = (std::max)(layout.fButtonCount, static_cast<size_t>(button) + 1);
+
+            // Extend the previous run when both the source bit and the button follow it.
+            if (report.buttonRuns.empty() == false)
+            {
+                HidDeviceLayout::ButtonRun& run = report.buttonRuns.back();
+                const uint32_t count = run.count;
+                if (run.word == word && run.wordShift + count == wordShift && run.byteOffset * 8 + run.shift + count == bitOffset && count < MaxRunButtons)
+                {
+                    run.count++;
+                    run.sourceMask = static_cast<uint32_t>((uint64_t{ 1 } << run.count) - 1);
+                    return;
+                }
+            }
+
+            report.buttonRuns.push_back(HidDeviceLayout::ButtonRun{ bitOffset / 8, static_cast<uint8_t>(bitOffset % 8), wordShift, word, 1, 1 });
+        }
+
+        static void AddInput(HidDeviceLayout& layout, const GlobalState& global, const LocalState& local, uint32_t flags)
+        {
+            HidDeviceLayout::ReportLayout& report = GetReport(layout, global.reportId);
+            const uint32_t bitOffset = report.sizeBits;
+            const uint32_t reportSize = global.reportSize;
+            const uint32_t reportCount = global.reportCount;
+            report.sizeBits += reportSize * reportCount;
+
+            if ((flags & InputConstant) != 0 || reportSize == 0 || reportSize > MaxFieldBits)
+                return;
+
+            // Logical Maximum 255 encoded in a single byte is a common descriptor bug, read it as unsigned.
+            int32_t logicalMin = global.logicalMin;
+            int32_t logicalMax = global.logicalMax;
+            if (logicalMin >= 0 && logicalMax < logicalMin)
+                logicalMax = static_cast<int32_t>(global.logicalMaxUnsigned);
+
+            if ((flags & InputVariable) == 0)
+            {
+                // Array: each entry is an index into the usages of the item.
+                if (local.usages.empty() || local.usages.front().usagePage != static_cast<uint16_t>(HidUsagePage::Button))
+                    return;
+
+                const UsageRange& range = local.usages.front();
+                if (range.usageMax != 0)
+                    layout.fButtonCount = (std::max)(layout.fButtonCount, static_cast<size_t>(range.usageMax));
+                report.buttonArrays.push_back(HidDeviceLayout::ButtonArray{ bitOffset, static_cast<uint8_t>(reportSize), static_cast<uint16_t>(reportCount)
+                    , logicalMin, logicalMax, range.usageMin, range.usageMax });
+                return;
+            }
+
+            for (uint32_t i = 0; i < reportCount; i++)
+            {
+                uint16_t usagePage = 0;
+                uint16_t usage = 0;
+                if (GetUsage(local, i, usagePage, usage) == false || usage == 0 || usagePage >= static_cast<uint16_t>(HidUsagePage::VendorDefinedFirst))
+                    continue;
+
+                const uint32_t fieldOffset = bitOffset + i * reportSize;
+                if (usagePage == static_cast<uint16_t>(HidUsagePage::Button) && reportSize == 1)
+                {
+                    AddButton(layout, report, fieldOffset, usage);
+                }
+                else
+                {
+                    const HidValueInfo info{ usagePage, usage, logicalMin, logicalMax, static_cast<uint8_t>(reportSize) };
+                    const uint32_t mask = static_cast<uint32_t>((uint64_t{ 1 } << reportSize) - 1);
+                    const uint32_t signBit = logicalMin < 0 ? uint32_t{ 1 } << (reportSize - 1) : 0;
+                    report.values.push_back(HidDeviceLayout::ValueField{ fieldOffset / 8, static_cast<uint8_t>(fieldOffset % 8), GetValueIndex(layout, report, info), mask, signBit });
+                }
+            }
+        }
+    };
+}
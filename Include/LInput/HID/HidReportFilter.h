@@ -0,0 +1,67 @@
+/*
+Copyright (c) 2020 Lior Lahav
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+namespace LInput
+{
+    /// <summary>
+    /// Drops HID input reports identical to the previous report with the same report ID, before they are decoded.
+    /// Idle devices keep streaming the same report at their polling rate, filtering them costs a memcmp.
+    /// Storage is allocated the first time a report ID or a longer report is seen.
+    /// </summary>
+    class HidReportFilter
+    {
+    public:
+        explicit HidReportFilter(bool usesReportIds = false) : fLastReports(usesReportIds ? MaxReportIds : 1) {}
+
+        /// <summary>
+        /// Returns true and remembers the report if it differs from the last report with its report ID.
+        /// </summary>
+        bool Changed(const uint8_t* report, size_t size)
+        {
+            std::vector<uint8_t>& last = fLastReports[fLastReports.size() > 1 && size > 0 ? report[0] : 0];
+            if (last.size() == size && (size == 0 || std::memcmp(last.data(), report, size) == 0))
+                return false;
+
+            last.assign(report, report + size);
+            return true;
+        }
+
+        /// <summary>
+        /// Forgets the last reports, so the next report of every ID passes.
+        /// </summary>
+        void Reset()
+        {
+            for (std::vector<uint8_t>& last : fLastReports)
+                last.clear();
+        }
+
+    private:
+        static constexpr size_t MaxReportIds = 256;
+        std::vector<std::vector<uint8_t>> fLastReports;
+    };
+}
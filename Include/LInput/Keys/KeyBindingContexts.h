@@ -0,0 +1,143 @@
+/*
+Copyright (c) 2020 Lior Lahav
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <LLUtils/Exception.h>
+#include "KeyBindings.h"
+
+namespace LInput
+{
+    /// <summary>
+    /// Stack of binding contexts, e.g. gameplay, menu, text field, modal dialog.
+    /// Lookups fall through from the top layer to the bottom one, the first layer with a matching spec wins.
+    /// Push and Pop only update the stack and its signature, the merged "effective" table of a stack configuration
+    /// is built once on first lookup and cached by signature, so lookups stay a single frozen table probe at any depth.
+    /// Layers must outlive the stack and must not be modified while cached, call InvalidateCache after editing a layer.
+    /// </summary>
+    template <class BindingType>
+    class KeyBindingContextStack
+    {
+    public:
+        using Layer = KeyBindings<BindingType>;
+
+        void Push(const Layer& layer)
+        {
+            const uint64_t parentSignature = mLayers.empty() ? 0 : mSignatures.back();
+            mLayers.push_back(&layer);
+            mSignatures.push_back(CombineSignature(parentSignature, &layer));
+            mEffective = nullptr;
+        }
+
+        void Pop()
+        {
+            if (mLayers.empty())
+                LL_EXCEPTION(LLUtils::Exception::ErrorCode::LogicError, "trying to pop an empty binding context stack");
+
+            mLayers.pop_back();
+            mSignatures.pop_back();
+            mEffective = nullptr;
+        }
+
+        size_t size() const
+        {
+            return mLayers.size();
+        }
+
+        bool empty() const
+        {
+            return mLayers.empty();
+        }
+
+        const Layer& top() const
+        {
+            return *mLayers.back();
+        }
+
+        /// <summary>
+        /// Bindings of the most specific matching spec of the top most layer that has a match.
+        /// The span is valid until the cache is invalidated.
+        /// </summary>
+        Span<const BindingType> GetBindings(KeyCombination combination)
+        {
+            const Layer* effective = GetEffective();
+            return effective != nullptr ? effective->GetBindings(combination) : Span<const BindingType>{};
+        }
+
+        /// <summary>
+        /// Drops all the cached effective tables.
+        /// </summary>
+        void InvalidateCache()
+        {
+            mCache.clear();
+            mEffective = nullptr;
+        }
+
+    private:
+        struct CacheEntry
+        {
+            std::vector<const Layer*> layers;
+            std::unique_ptr<Layer> effective;
+        };
+
+        static uint64_t CombineSignature(uint64_t parent, const Layer* layer)
+        {
+            return PerfectHashIndex::Hash(parent ^ static_cast<uint64_t>(reinterpret_cast<uintptr_t>(layer)), static_cast<uint32_t>(parent >> 32));
+        }
+
+        const Layer* GetEffective()
+        {
+            if (mEffective != nullptr || mLayers.empty())
+                return mEffective;
+
+            // A single layer is its own effective table.
+            if (mLayers.size() == 1)
+                return mEffective = mLayers.front();
+
+            const uint64_t signature = mSignatures.back();
+            auto range = mCache.equal_range(signature);
+            for (auto it = range.first; it != range.second; ++it)
+                if (it->second.layers == mLayers)
+                    return mEffective = it->second.effective.get();
+
+            auto effective = std::make_unique<Layer>(*mLayers.back());
+            for (auto it = mLayers.rbegin() + 1; it != mLayers.rend(); ++it)
+                effective->AppendFallback(**it);
+            effective->Freeze();
+
+            mEffective = effective.get();
+            mCache.emplace(signature, CacheEntry{ mLayers, std::move(effective) });
+            return mEffective;
+        }
+
+        std::vector<const Layer*> mLayers;
+        /// <summary>
+        /// Signature of the stack up to and including each layer.
+        /// </summary>
+        std::vector<uint64_t> mSignatures;
+        const Layer* mEffective = nullptr;
+        std::unordered_multimap<uint64_t, CacheEntry> mCache;
+    };
+}
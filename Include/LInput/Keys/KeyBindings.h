@@ -22,39 +22,56 @@ SOFTWARE.
 
 #pragma once
 #include "KeyCombination.h"
+#include "PerfectHashIndex.h"
+#include "Span.h"
+#include <cstddef>
+#include <algorithm>
 #include <unordered_map>
 #include <LLUtils/Exception.h>
 
 namespace LInput
 {
+    /// <summary>
+    /// Maps key combination specs to bindings.
+    /// Specs are bucketed by canonical key code, a bucket holds each distinct spec once, most specific first,
+    /// so side agnostic specs (e.g. "Control+A") cost a single entry and are matched with KeyCombination::Matches.
+    /// </summary>
     template <class BindingType>
     class KeyBindings
     {
     public:
         using ConcreteBindingType = std::vector<BindingType>;
     private:
-        
-        using MapCombinationToBinding = std::unordered_map<KeyCombination, ConcreteBindingType, KeyCombination::Hash>;
+        struct BindingSpec
+        {
+            KeyCombination combination;
+            ConcreteBindingType bindings;
+        };
+
+        using ListBindingSpecs = std::vector<BindingSpec>;
+        using MapKeyCodeToSpecs = std::unordered_map<KeyCode, ListBindingSpecs>;
 
 
     public:
       void AddBinding(KeyCombination combination,const BindingType& binding)
       {
-          if (static_cast<KeyCode>(combination.keydata().keycode) == KeyCode::UNASSIGNED)
+          if (combination.GetKeyCode() == KeyCode::UNASSIGNED)
               LL_EXCEPTION(LLUtils::Exception::ErrorCode::LogicError , "trying to add an 'Unassigned' key binding");
 
-
-          auto it = mBindings.find(combination);
+          mFrozen = false;
+          ListBindingSpecs& specs = mBindings[KeyCombination::CanonicalKeyCode(combination.GetKeyCode())];
+          auto it = std::find_if(specs.begin(), specs.end(), [&combination](const BindingSpec& spec) { return spec.combination == combination; });
           
-          if (it == mBindings.end())
+          if (it == specs.end())
           {
-              auto ib = mBindings.emplace(combination, ConcreteBindingType{ binding });
-              if (ib.second == false)
-                  LL_EXCEPTION(LLUtils::Exception::ErrorCode::DuplicateItem, "duplicate entries are not allowed");
+              // Keep the most specific specs first, the first match of a lookup is then the most specific one.
+              auto position = std::upper_bound(specs.begin(), specs.end(), combination.GetAgnosticCount()
+                  , [](int agnosticCount, const BindingSpec& spec) { return agnosticCount < spec.combination.GetAgnosticCount(); });
+              specs.insert(position, BindingSpec{ combination, ConcreteBindingType{ binding } });
           }
           else
           {
-              ConcreteBindingType& bindings = it->second;
+              ConcreteBindingType& bindings = it->bindings;
               bindings.push_back(binding);
           }
 
@@ -67,20 +84,146 @@ namespace LInput
               AddBinding(comb, binding);
       }
 
+      /// <summary>
+      /// Appends the specs of 'lower' after the specs of this table, a spec of 'lower' is matched only if no spec of this table matches.
+      /// Specs already present in this table are skipped, they would never be reached.
+      /// </summary>
+      void AppendFallback(const KeyBindings& lower)
+      {
+          mFrozen = false;
+          for (const auto& [keyCode, lowerSpecs] : lower.mBindings)
+          {
+              ListBindingSpecs& specs = mBindings[keyCode];
+              const size_t ownSpecs = specs.size();
+              for (const BindingSpec& lowerSpec : lowerSpecs)
+              {
+                  auto end = specs.begin() + static_cast<std::ptrdiff_t>(ownSpecs);
+                  if (std::find_if(specs.begin(), end, [&lowerSpec](const BindingSpec& spec) { return spec.combination == lowerSpec.combination; }) == end)
+                      specs.push_back(lowerSpec);
+              }
+          }
+      }
+
+      /// <summary>
+      /// Builds a flat, immutable perfect hash table of the current bindings, lookups use it until the next AddBinding.
+      /// </summary>
+      void Freeze()
+      {
+          std::vector<uint64_t> keys;
+          keys.reserve(mBindings.size());
+          for (const auto& [keyCode, specs] : mBindings)
+              keys.push_back(static_cast<uint64_t>(keyCode));
+
+          mFrozenIndex.Build(keys);
+          mFrozenSlots.assign(mFrozenIndex.TableSize(), FrozenSlot{});
+          mFrozenSpecs.clear();
+          mFrozenBindings.clear();
+          for (const auto& [keyCode, specs] : mBindings)
+          {
+              FrozenSlot& slot = mFrozenSlots[mFrozenIndex.Slot(static_cast<uint64_t>(keyCode))];
+              slot.keyCode = keyCode;
+              slot.specOffset = static_cast<uint32_t>(mFrozenSpecs.size());
+              slot.specCount = static_cast<uint32_t>(specs.size());
+              for (const BindingSpec& spec : specs)
+              {
+                  mFrozenSpecs.push_back(FrozenSpec{ spec.combination, static_cast<uint32_t>(mFrozenBindings.size()), static_cast<uint32_t>(spec.bindings.size()) });
+                  mFrozenBindings.insert(mFrozenBindings.end(), spec.bindings.begin(), spec.bindings.end());
+              }
+          }
+
+          mFrozen = true;
+      }
+
+      bool IsFrozen() const
+      {
+          return mFrozen;
+      }
+
+      /// <summary>
+      /// Returns the bindings of the most specific spec matching the pressed keys in 'combination' without copying,
+      /// an empty span if there are none. The span is valid until the next AddBinding or Freeze.
+      /// </summary>
+      Span<const BindingType> GetBindings(KeyCombination combination) const
+      {
+          Span<const BindingType> result;
+          ForEachMatch(combination, [&result](Span<const BindingType> bindings)
+          {
+              result = bindings;
+              return false;
+          });
+          return result;
+      }
+
+      /// <summary>
+      /// Copies to 'bindingType' the bindings of every spec matching the pressed keys in 'combination', most specific first.
+      /// </summary>
       bool GetBinding(KeyCombination combination, ConcreteBindingType& bindingType)
       {
-          static BindingType empty;
-          typename MapCombinationToBinding::const_iterator it = mBindings.find(combination);
-          if (it != mBindings.end())
+          bindingType.clear();
+          ForEachMatch(combination, [&bindingType](Span<const BindingType> bindings)
           {
-              bindingType = it->second;
+              bindingType.insert(bindingType.end(), bindings.begin(), bindings.end());
               return true;
-          }
-          return false;
+          });
+          return bindingType.empty() == false;
       }
 
     private:
-        MapCombinationToBinding mBindings;
+        struct FrozenSlot
+        {
+            KeyCode keyCode = KeyCode::UNASSIGNED;
+            uint32_t specOffset = 0;
+            uint32_t specCount = 0;
+        };
+
+        struct FrozenSpec
+        {
+            KeyCombination combination;
+            uint32_t bindingOffset;
+            uint32_t bindingCount;
+        };
+
+        /// <summary>
+        /// Invokes func(Span<const BindingType>) for every spec matching 'combination', most specific first, until func returns false.
+        /// </summary>
+        template <typename Func>
+        void ForEachMatch(KeyCombination combination, Func&& func) const
+        {
+            const KeyCode keyCode = KeyCombination::CanonicalKeyCode(combination.GetKeyCode());
+            if (mFrozen)
+            {
+                // Unassigned key codes are never bound, so the empty slots can't produce a false hit.
+                const FrozenSlot& slot = mFrozenSlots[mFrozenIndex.Slot(static_cast<uint64_t>(keyCode))];
+                if (slot.keyCode != keyCode)
+                    return;
+
+                for (uint32_t i = slot.specOffset; i < slot.specOffset + slot.specCount; i++)
+                {
+                    const FrozenSpec& spec = mFrozenSpecs[i];
+                    if (spec.combination.Matches(combination) && func(Span<const BindingType>(mFrozenBindings.data() + spec.bindingOffset, spec.bindingCount)) == false)
+                        return;
+                }
+                return;
+            }
+
+            typename MapKeyCodeToSpecs::const_iterator it = mBindings.find(keyCode);
+            if (it == mBindings.end())
+                return;
+
+            for (const BindingSpec& spec : it->second)
+                if (spec.combination.Matches(combination) && func(Span<const BindingType>(spec.bindings.data(), spec.bindings.size())) == false)
+                    return;
+        }
+
+        MapKeyCodeToSpecs mBindings;
+        bool mFrozen = false;
+        PerfectHashIndex mFrozenIndex;
+        std::vector<FrozenSlot> mFrozenSlots;
+        std::vector<FrozenSpec> mFrozenSpecs;
+        /// <summary>
+        /// Bindings of all the specs, each spec's bindings are contiguous.
+        /// </summary>
+        ConcreteBindingType mFrozenBindings;
 
     };
 }
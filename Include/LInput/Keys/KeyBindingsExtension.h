@@ -0,0 +1,106 @@
+/*
+Copyright (c) 2020 Lior Lahav
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <cstdint>
+#include <type_traits>
+#include <LLUtils/Event.h>
+#include <LInput/Buttons/ButtonState.h>
+#include <LInput/Buttons/IButtonStateExtension.h>
+#include <LInput/Timing/Clock.h>
+#include "KeyBindings.h"
+#include "KeyCodeIndex.h"
+
+namespace LInput
+{
+    /// <summary>
+    /// Keeps the modifier state up to date from the keyboard transitions and dispatches key presses to KeyBindings,
+    /// a portable replacement for KeyCombination::FromVirtualKey that needs no keyboard state query per key.
+    /// button_type - KeyIndex, KeyCode or an integral scan code.
+    /// </summary>
+    template <typename button_type, typename BindingType>
+    class KeyBindingsExtension final : public IButtonStateExtension<button_type>
+    {
+    public:
+        struct BindingEvent
+        {
+            KeyBindingsExtension* parent;
+            /// <summary>
+            /// The pressed key and the modifiers held down with it.
+            /// </summary>
+            KeyCombination combination;
+            /// <summary>
+            /// Bindings of the most specific matching spec, valid for the duration of the event.
+            /// </summary>
+            Span<const BindingType> bindings;
+            uint64_t timeStamp;
+        };
+
+        LLUtils::Event<void(const BindingEvent&)> OnBinding;
+
+        /// <summary>
+        /// 'bindings' must outlive the extension, it may be frozen and edited between events.
+        /// </summary>
+        explicit KeyBindingsExtension(const KeyBindings<BindingType>& bindings) : fBindings(bindings) {}
+
+        void SetButtonState(button_type button, ButtonState newState, SteadyClock::tick_type timeStamp = TimeStampNow) override
+        {
+            const KeyCode keyCode = ToKeyCode(button);
+            const uint32_t modifierBit = KeyCombination::ModifierBit(keyCode);
+            if (modifierBit != 0)
+            {
+                fModifiers.combinationID = newState == ButtonState::Down ? fModifiers.combinationID | modifierBit : fModifiers.combinationID & ~modifierBit;
+                return;
+            }
+
+            // Fake shifts surround some E0 prefixed keys, they are neither modifiers nor keys.
+            if (newState != ButtonState::Down || keyCode == KeyCode::FAKELSHIFT || keyCode == KeyCode::FAKERSHIFT || keyCode == KeyCode::UNASSIGNED)
+                return;
+
+            KeyCombination combination = fModifiers;
+            combination.keydata().keycode = keyCode;
+            const Span<const BindingType> bindings = fBindings.GetBindings(combination);
+            if (bindings.empty() == false)
+                OnBinding.Raise(BindingEvent{ this, combination, bindings, timeStamp != TimeStampNow ? timeStamp : SteadyClock::Now() });
+        }
+
+        /// <summary>
+        /// The modifiers currently held down, only the sided modifier flags are set.
+        /// </summary>
+        KeyCombination GetModifiers() const
+        {
+            return fModifiers;
+        }
+
+    private:
+        static KeyCode ToKeyCode(button_type button)
+        {
+            if constexpr (std::is_same_v<button_type, KeyIndex>)
+                return KeyCodeIndex::ToKeyCode(button);
+            else
+                return static_cast<KeyCode>(button);
+        }
+
+        const KeyBindings<BindingType>& fBindings;
+        KeyCombination fModifiers;
+    };
+}
@@ -21,7 +21,8 @@ SOFTWARE.
 */
 
 #pragma once
-#include <map>
+#include <cstdint>
+#include <utility>
 
 namespace LInput
 {
@@ -205,12 +206,36 @@ namespace LInput
         , MENU               = 0XE05D // (Menu)
         , PAUSE1             = 0XE11D // (Pause)
 
+        //Media keys, raw input reports them E0 prefixed
+        , PREVTRACK2         = 0XE010 // Previous Track
+        , NEXTTRACK2         = 0XE019 // Next Track
+        , MUTE2              = 0XE020 // Mute
+        , CALCULATOR2        = 0XE021 // Calculator
+        , PLAYPAUSE2         = 0XE022 // Play / Pause
+        , MEDIASTOP2         = 0XE024 // Media Stop
+        , VOLUMEDOWN2        = 0XE02E // Volume -
+        , VOLUMEUP2          = 0XE030 // Volume +
+        , WEBHOME2           = 0XE032 // Web home
+        , POWER2             = 0XE05E // System Power
+        , SLEEP2             = 0XE05F // System Sleep
+        , WAKE2              = 0XE063 // System Wake
+        , WEBSEARCH2         = 0XE065 // Web Search
+        , WEBFAVORITES2      = 0XE066 // Web Favorites
+        , WEBREFRESH2        = 0XE067 // Web Refresh
+        , WEBSTOP2           = 0XE068 // Web Stop
+        , WEBFORWARD2        = 0XE069 // Web Forward
+        , WEBBACK2           = 0XE06A // Web Back
+        , MYCOMPUTER2        = 0XE06B // My Computer
+        , MAIL2              = 0XE06C // Mail
+        , MEDIASELECT2       = 0XE06D // Media Select
+
 
     };
 
 
 
-	const std::map<KeyCode, const char*> KeyCodeString 
+	// Sorted by key code.
+	inline constexpr std::pair<KeyCode, const char*> KeyCodeString[]
     {
 		
 		 {KeyCode::UNASSIGNED ,"UNASSIGNED"}
@@ -383,6 +408,29 @@ namespace LInput
 		,{ KeyCode::RIGHTWINDOW,                  "RIGHTWINDOW" }
 		,{ KeyCode::MENU,                         "MENU"        }
 	   , { KeyCode::PAUSE1,                         "PAUSE1" }
+
+		//Media keys
+		,{KeyCode::PREVTRACK2,                   "PREVTRACK2"   }
+		,{KeyCode::NEXTTRACK2,                   "NEXTTRACK2"   }
+		,{KeyCode::MUTE2,                        "MUTE2"        }
+		,{KeyCode::CALCULATOR2,                  "CALCULATOR2"  }
+		,{KeyCode::PLAYPAUSE2,                   "PLAYPAUSE2"   }
+		,{KeyCode::MEDIASTOP2,                   "MEDIASTOP2"   }
+		,{KeyCode::VOLUMEDOWN2,                  "VOLUMEDOWN2"  }
+		,{KeyCode::VOLUMEUP2,                    "VOLUMEUP2"    }
+		,{KeyCode::WEBHOME2,                     "WEBHOME2"     }
+		,{KeyCode::POWER2,                       "POWER2"       }
+		,{KeyCode::SLEEP2,                       "SLEEP2"       }
+		,{KeyCode::WAKE2,                        "WAKE2"        }
+		,{KeyCode::WEBSEARCH2,                   "WEBSEARCH2"   }
+		,{KeyCode::WEBFAVORITES2,                "WEBFAVORITES2" }
+		,{KeyCode::WEBREFRESH2,                  "WEBREFRESH2"  }
+		,{KeyCode::WEBSTOP2,                     "WEBSTOP2"     }
+		,{KeyCode::WEBFORWARD2,                  "WEBFORWARD2"  }
+		,{KeyCode::WEBBACK2,                     "WEBBACK2"     }
+		,{KeyCode::MYCOMPUTER2,                  "MYCOMPUTER2"  }
+		,{KeyCode::MAIL2,                        "MAIL2"        }
+		,{KeyCode::MEDIASELECT2,                 "MEDIASELECT2" }
 		
     };
 #pragma pop_macro("DELETE")
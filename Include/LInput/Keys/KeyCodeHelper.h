@@ -21,9 +21,10 @@ SOFTWARE.
 */
 
 #pragma once
-#include <algorithm>
-#include <string>
+#include <cstdint>
+#include <string_view>
 #include "KeyCode.h"
+#include "KeyCodeNames.h"
 #include "../Buttons/ButtonState.h"
 
 #ifdef _WIN32
@@ -37,58 +38,32 @@ namespace LInput
     {
     public:
 
-        static std::string KeyCodeToString(KeyCode keycode)
+        static std::string_view KeyCodeToString(KeyCode keycode)
         {
-			
-            auto foundItem = std::find_if(KeyCodeString.begin(), KeyCodeString.end(),
-                [&keycode](decltype(KeyCodeString)::value_type const& item)
-            {
-                return keycode == item.first;
-            });
-			
-			return foundItem !=  KeyCodeString.end() ?  foundItem->second : "Key not found";
+            const std::string_view name = KeyCodeNames::ToName(keycode);
+            return name.empty() == false ? name : "Key not found";
         }
 
-        static KeyCode KeyNameToKeyCode(const std::string& keyName)
+        /// <summary>
+        /// Case insensitive, returns KeyCode::UNASSIGNED for unknown names.
+        /// </summary>
+        static KeyCode KeyNameToKeyCode(std::string_view keyName)
         {
-            auto foundItem = std::find_if(KeyCodeString.begin(), KeyCodeString.end(),
-                [&keyName](decltype(KeyCodeString)::value_type const& item)
-            {
-                return keyName == item.second;
-            });
-
-            return foundItem != KeyCodeString.end() ? foundItem->first :KeyCode::UNASSIGNED;
+            return KeyCodeNames::FromName(keyName);
         }
 
-        static std::vector<std::vector<size_t>> ComputeCombinations(std::vector<size_t> groupSizes)
+        /// <summary>
+        /// Key code of a raw input make code and its E0 / E1 prefix.
+        /// </summary>
+        static constexpr KeyCode KeyCodeFromScanCode(uint16_t makeCode, bool e0, bool e1)
         {
-            using namespace std;
-
-            vector<vector<size_t>> result;
-            const size_t totalGroups = groupSizes.size();
-            vector<size_t> accumulativeSize = std::vector<size_t>(totalGroups);
-            size_t totalElements = 1;
-            for (size_t i = 0; i < groupSizes.size(); i++)
-            {
-                totalElements *= groupSizes[i];
-                accumulativeSize[i] = totalElements;
-            }
-
-            for (size_t e = 0; e < totalElements; e++)
-            {
-                vector<size_t> indices = std::vector<size_t>(totalGroups);
-
-                for (size_t i = 0; i < indices.size(); i++)
-                {
-                    size_t accumulativeFactor = i == 0 ? 1 : accumulativeSize[i - 1];
-                    indices[i] = (e / accumulativeFactor) % groupSizes[i];
-                }
-                result.push_back(indices);
-
-            }
-            return result;
+            return static_cast<KeyCode>(
+                  (e0 ? 0xE000u : 0u)
+                | (e1 ? 0xE100u : 0u)
+                | makeCode);
         }
 
+#ifdef _WIN32
         struct KeyEventParams
         {
             unsigned short repeatCount : 16;  // 0 - 15	The repeat count for the current message.The value is the number of times the keystroke is autorepeated as a result of the user holding down the key.If the keystroke is held long enough, multiple messages are sent.However, the repeat count is not cumulative.
@@ -110,15 +85,7 @@ namespace LInput
 
 		static KeyCode KeyCodeFromRawInput(const RAWKEYBOARD& keyboard)
 		{
-			return static_cast<KeyCode>
-				(
-			  static_cast<uint16_t>(0)
-			| (   (keyboard.Flags  & RI_KEY_E0) != 0  ? static_cast<uint16_t>(0xE000) : 0 )
-			| ( (keyboard.Flags  & RI_KEY_E1) != 0    ? static_cast<uint16_t>(0xE100) : 0)
-			| static_cast<uint16_t>(keyboard.MakeCode)
-					)
-				;
-				
+			return KeyCodeFromScanCode(keyboard.MakeCode, (keyboard.Flags & RI_KEY_E0) != 0, (keyboard.Flags & RI_KEY_E1) != 0);
 		}
         
 		static std::pair< KeyCode, ButtonState> KeyEventFromRawInput(const RAWKEYBOARD& keyboard)
@@ -128,7 +95,6 @@ namespace LInput
 
 			return {keyCode, state};
 		}
-
-
+#endif
     };
 }
@@ -0,0 +1,108 @@
+/*
+Copyright (c) 2020 Lior Lahav
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include "KeyCode.h"
+
+namespace LInput
+{
+    /// <summary>
+    /// Dense index of a KeyCode in the range [0, KeyCodeIndex::Count).
+    /// </summary>
+    enum class KeyIndex : uint8_t {};
+
+    namespace Detail
+    {
+        // Scan codes are spread over three pages of 256 entries: no prefix, E0 prefix and E1 prefix.
+        constexpr size_t KeyCodePageSize = 256;
+        constexpr size_t KeyCodeNumPages = 3;
+        constexpr uint8_t KeyCodeInvalidIndex = 0xFF;
+        constexpr size_t KeyCodeCount = std::size(KeyCodeString);
+
+        static_assert(KeyCodeCount < KeyCodeInvalidIndex, "KeyIndex can't hold all the key codes");
+
+        constexpr size_t KeyCodePage(uint16_t keyCode)
+        {
+            const uint16_t prefix = static_cast<uint16_t>(keyCode >> 8);
+            return prefix == 0 ? 0 : prefix == 0xE0 ? 1 : prefix == 0xE1 ? 2 : KeyCodeNumPages;
+        }
+
+        constexpr std::array<uint8_t, KeyCodePageSize * KeyCodeNumPages> BuildKeyCodeToIndexTable()
+        {
+            std::array<uint8_t, KeyCodePageSize * KeyCodeNumPages> table{};
+            for (uint8_t& index : table)
+                index = KeyCodeInvalidIndex;
+
+            for (size_t i = 0; i < KeyCodeCount; i++)
+            {
+                const uint16_t keyCode = static_cast<uint16_t>(KeyCodeString[i].first);
+                const size_t page = KeyCodePage(keyCode);
+                const size_t slot = page * KeyCodePageSize + (keyCode & 0xFF);
+                if (page == KeyCodeNumPages || table[slot] != KeyCodeInvalidIndex)
+                    throw "Key code is either out of the supported pages or duplicated";
+
+                table[slot] = static_cast<uint8_t>(i);
+            }
+            return table;
+        }
+
+        inline constexpr std::array<uint8_t, KeyCodePageSize * KeyCodeNumPages> KeyCodeToIndexTable = BuildKeyCodeToIndexTable();
+    }
+
+    /// <summary>
+    /// Bijective mapping between KeyCode and a dense index, so per key data can be stored in flat arrays of KeyCodeIndex::Count entries
+    /// instead of arrays sized by the largest (E0/E1 prefixed) scan code.
+    /// The index of a key is its position in KeyCodeString.
+    /// </summary>
+    class KeyCodeIndex
+    {
+    public:
+        static constexpr size_t Count = Detail::KeyCodeCount;
+        static constexpr KeyIndex InvalidIndex = static_cast<KeyIndex>(Detail::KeyCodeInvalidIndex);
+
+        static constexpr KeyIndex ToIndex(KeyCode keyCode)
+        {
+            const uint16_t code = static_cast<uint16_t>(keyCode);
+            const size_t page = Detail::KeyCodePage(code);
+            return page < Detail::KeyCodeNumPages
+                ? static_cast<KeyIndex>(Detail::KeyCodeToIndexTable[page * Detail::KeyCodePageSize + (code & 0xFF)])
+                : InvalidIndex;
+        }
+
+        static constexpr KeyCode ToKeyCode(KeyIndex index)
+        {
+            return IsValid(index) ? KeyCodeString[static_cast<size_t>(index)].first : KeyCode::UNASSIGNED;
+        }
+
+        static constexpr bool IsValid(KeyIndex index)
+        {
+            return static_cast<size_t>(index) < Count;
+        }
+    };
+
+    static_assert(KeyCodeIndex::ToKeyCode(KeyCodeIndex::ToIndex(KeyCode::PAUSE1)) == KeyCode::PAUSE1, "KeyCodeIndex mapping is broken");
+    static_assert(KeyCodeIndex::ToIndex(static_cast<KeyCode>(0xE0FF)) == KeyCodeIndex::InvalidIndex, "KeyCodeIndex mapping is broken");
+}
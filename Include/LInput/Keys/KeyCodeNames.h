@@ -0,0 +1,224 @@
+/*
+Copyright (c) 2020 Lior Lahav
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+#include "KeyCode.h"
+#include "KeyCodeIndex.h"
+
+namespace LInput
+{
+    namespace Detail
+    {
+        constexpr char ToUpperAscii(char c)
+        {
+            return c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c;
+        }
+
+        constexpr bool EqualsIgnoreCase(std::string_view lhs, std::string_view rhs)
+        {
+            if (lhs.size() != rhs.size())
+                return false;
+
+            for (size_t i = 0; i < lhs.size(); i++)
+                if (ToUpperAscii(lhs[i]) != ToUpperAscii(rhs[i]))
+                    return false;
+
+            return true;
+        }
+
+        /// <summary>
+        /// Case insensitive FNV-1a, finalized with splitmix so neighbouring seeds give independent slots.
+        /// </summary>
+        constexpr uint64_t HashKeyName(std::string_view name, uint32_t seed)
+        {
+            uint64_t hash = 0xCBF29CE484222325ull ^ seed;
+            for (char c : name)
+                hash = (hash ^ static_cast<uint8_t>(ToUpperAscii(c))) * 0x100000001B3ull;
+
+            hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+            hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+            return hash ^ (hash >> 31);
+        }
+
+        constexpr std::array<std::string_view, KeyCodeCount> BuildKeyCodeNames()
+        {
+            std::array<std::string_view, KeyCodeCount> names{};
+            for (size_t i = 0; i < KeyCodeCount; i++)
+                names[i] = KeyCodeString[i].second;
+            return names;
+        }
+
+        inline constexpr std::array<std::string_view, KeyCodeCount> KeyCodeNames = BuildKeyCodeNames();
+
+        // Hash and displace: names are split into buckets by an unseeded hash, each bucket gets the first seed
+        // that places all of its names in free slots, larger buckets are placed first.
+        constexpr size_t KeyNameBuckets = 64;
+        constexpr size_t KeyNameSlots = 256;
+        constexpr uint32_t KeyNameMaxSeed = 0xFFFF;
+
+        static_assert(KeyCodeCount * 10 <= KeyNameSlots * 8, "The key name table load factor must not exceed 0.8");
+
+        struct KeyNameTable
+        {
+            std::array<uint16_t, KeyNameBuckets> seeds{};
+            /// <summary>
+            /// KeyIndex of the name in each slot, KeyCodeInvalidIndex for an empty slot.
+            /// </summary>
+            std::array<uint8_t, KeyNameSlots> slots{};
+        };
+
+        constexpr size_t KeyNameBucket(std::string_view name)
+        {
+            return static_cast<size_t>(HashKeyName(name, 0) >> 58);
+        }
+
+        constexpr size_t KeyNameSlot(std::string_view name, uint32_t seed)
+        {
+            return static_cast<size_t>(HashKeyName(name, seed) & (KeyNameSlots - 1));
+        }
+
+        constexpr KeyNameTable BuildKeyNameTable()
+        {
+            KeyNameTable table{};
+            for (uint8_t& slot : table.slots)
+                slot = KeyCodeInvalidIndex;
+
+            // Keys sorted by bucket, a name that appears twice resolves to its first key code.
+            std::array<size_t, KeyNameBuckets + 1> bucketStart{};
+            std::array<uint8_t, KeyCodeCount> keys{};
+            std::array<bool, KeyCodeCount> duplicate{};
+            for (size_t i = 0; i < KeyCodeCount; i++)
+            {
+                for (size_t j = 0; j < i && duplicate[i] == false; j++)
+                    duplicate[i] = EqualsIgnoreCase(KeyCodeNames[i], KeyCodeNames[j]);
+
+                if (duplicate[i] == false)
+                    bucketStart[KeyNameBucket(KeyCodeNames[i]) + 1]++;
+            }
+
+            for (size_t b = 0; b < KeyNameBuckets; b++)
+                bucketStart[b + 1] += bucketStart[b];
+
+            std::array<size_t, KeyNameBuckets> fill{};
+            for (size_t i = 0; i < KeyCodeCount; i++)
+            {
+                if (duplicate[i])
+                    continue;
+                const size_t bucket = KeyNameBucket(KeyCodeNames[i]);
+                keys[bucketStart[bucket] + fill[bucket]++] = static_cast<uint8_t>(i);
+            }
+
+            std::array<bool, KeyNameBuckets> placed{};
+            for (size_t pass = 0; pass < KeyNameBuckets; pass++)
+            {
+                size_t bucket = 0;
+                size_t largest = 0;
+                for (size_t b = 0; b < KeyNameBuckets; b++)
+                    if (placed[b] == false && fill[b] >= largest)
+                    {
+                        bucket = b;
+                        largest = fill[b];
+                    }
+
+                placed[bucket] = true;
+                if (largest == 0)
+                    continue;
+
+                const size_t first = bucketStart[bucket];
+                const size_t last = first + largest;
+                uint32_t seed = 1;
+                for (;; seed++)
+                {
+                    if (seed > KeyNameMaxSeed)
+                        throw "No perfect hash seed found for the key names";
+
+                    size_t k = first;
+                    for (; k < last; k++)
+                    {
+                        const size_t slot = KeyNameSlot(KeyCodeNames[keys[k]], seed);
+                        if (table.slots[slot] != KeyCodeInvalidIndex)
+                            break;
+                        table.slots[slot] = keys[k];
+                    }
+
+                    if (k == last)
+                        break;
+
+                    // Roll back the names of this bucket placed with the rejected seed.
+                    while (k-- > first)
+                        table.slots[KeyNameSlot(KeyCodeNames[keys[k]], seed)] = KeyCodeInvalidIndex;
+                }
+
+                table.seeds[bucket] = static_cast<uint16_t>(seed);
+            }
+
+            return table;
+        }
+
+        inline constexpr KeyNameTable KeyNameLookup = BuildKeyNameTable();
+    }
+
+    /// <summary>
+    /// Allocation free conversion between key codes and their names in KeyCodeString.
+    /// Code to name is a dense array indexed by KeyIndex, name to code is a perfect hash over the upper cased names,
+    /// both are built at compile time so each lookup is a few table reads.
+    /// </summary>
+    class KeyCodeNames
+    {
+    public:
+        /// <summary>
+        /// Returns an empty view for key codes not in KeyCodeString.
+        /// </summary>
+        static constexpr std::string_view ToName(KeyCode keyCode)
+        {
+            const KeyIndex index = KeyCodeIndex::ToIndex(keyCode);
+            return KeyCodeIndex::IsValid(index) ? Detail::KeyCodeNames[static_cast<size_t>(index)] : std::string_view{};
+        }
+
+        /// <summary>
+        /// Case insensitive, returns KeyCode::UNASSIGNED for unknown names.
+        /// </summary>
+        static constexpr KeyCode FromName(std::string_view name)
+        {
+            const uint16_t seed = Detail::KeyNameLookup.seeds[Detail::KeyNameBucket(name)];
+            if (seed == 0)
+                return KeyCode::UNASSIGNED;
+
+            const uint8_t index = Detail::KeyNameLookup.slots[Detail::KeyNameSlot(name, seed)];
+            return index != Detail::KeyCodeInvalidIndex && Detail::EqualsIgnoreCase(Detail::KeyCodeNames[index], name)
+                ? KeyCodeString[index].first
+                : KeyCode::UNASSIGNED;
+        }
+
+        static constexpr bool EqualsIgnoreCase(std::string_view lhs, std::string_view rhs)
+        {
+            return Detail::EqualsIgnoreCase(lhs, rhs);
+        }
+    };
+
+    static_assert(KeyCodeNames::FromName("ralt") == KeyCode::RALT, "KeyCodeNames mapping is broken");
+    static_assert(KeyCodeNames::FromName(KeyCodeNames::ToName(KeyCode::PAUSE1)) == KeyCode::PAUSE1, "KeyCodeNames mapping is broken");
+}
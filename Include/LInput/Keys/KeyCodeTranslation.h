@@ -0,0 +1,306 @@
+/*
+Copyright (c) 2020 Lior Lahav
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include "KeyCode.h"
+#include "KeyCodeIndex.h"
+
+namespace LInput
+{
+    namespace Detail
+    {
+        struct KeyCodeTranslationEntry
+        {
+            KeyCode keyCode;
+            /// <summary>
+            /// USB HID usage on the keyboard/keypad page (0x07), 0 if none.
+            /// </summary>
+            uint8_t hidUsage;
+            /// <summary>
+            /// Linux evdev KEY_* code, 0 if none.
+            /// </summary>
+            uint16_t evdevCode;
+        };
+
+        // The first entry of a key code, HID usage or evdev code wins: canonical entries come first and resolve to the
+        // E0 prefixed scan codes raw input reports, followed by aliases that only add the directions not yet mapped,
+        // e.g. the DirectInput style codes (RCONTROL, HOME...) and the HID Non-US # key.
+        inline constexpr KeyCodeTranslationEntry KeyCodeTranslationTable[]
+        {
+              { KeyCode::ESCAPE, 0x29, 1 }
+            , { KeyCode::KEY_1, 0x1E, 2 }
+            , { KeyCode::KEY_2, 0x1F, 3 }
+            , { KeyCode::KEY_3, 0x20, 4 }
+            , { KeyCode::KEY_4, 0x21, 5 }
+            , { KeyCode::KEY_5, 0x22, 6 }
+            , { KeyCode::KEY_6, 0x23, 7 }
+            , { KeyCode::KEY_7, 0x24, 8 }
+            , { KeyCode::KEY_8, 0x25, 9 }
+            , { KeyCode::KEY_9, 0x26, 10 }
+            , { KeyCode::KEY_0, 0x27, 11 }
+            , { KeyCode::MINUS, 0x2D, 12 }
+            , { KeyCode::EQUALS, 0x2E, 13 }
+            , { KeyCode::BACK, 0x2A, 14 }
+            , { KeyCode::TAB, 0x2B, 15 }
+            , { KeyCode::Q, 0x14, 16 }
+            , { KeyCode::W, 0x1A, 17 }
+            , { KeyCode::E, 0x08, 18 }
+            , { KeyCode::R, 0x15, 19 }
+            , { KeyCode::T, 0x17, 20 }
+            , { KeyCode::Y, 0x1C, 21 }
+            , { KeyCode::U, 0x18, 22 }
+            , { KeyCode::I, 0x0C, 23 }
+            , { KeyCode::O, 0x12, 24 }
+            , { KeyCode::P, 0x13, 25 }
+            , { KeyCode::LBRACKET, 0x2F, 26 }
+            , { KeyCode::RBRACKET, 0x30, 27 }
+            , { KeyCode::ENTERMAIN, 0x28, 28 }
+            , { KeyCode::LCONTROL, 0xE0, 29 }
+            , { KeyCode::A, 0x04, 30 }
+            , { KeyCode::S, 0x16, 31 }
+            , { KeyCode::D, 0x07, 32 }
+            , { KeyCode::F, 0x09, 33 }
+            , { KeyCode::G, 0x0A, 34 }
+            , { KeyCode::H, 0x0B, 35 }
+            , { KeyCode::J, 0x0D, 36 }
+            , { KeyCode::K, 0x0E, 37 }
+            , { KeyCode::L, 0x0F, 38 }
+            , { KeyCode::SEMICOLON, 0x33, 39 }
+            , { KeyCode::APOSTROPHE, 0x34, 40 }
+            , { KeyCode::GRAVE, 0x35, 41 }
+            , { KeyCode::LSHIFT, 0xE1, 42 }
+            , { KeyCode::BACKSLASH, 0x31, 43 }
+            , { KeyCode::Z, 0x1D, 44 }
+            , { KeyCode::X, 0x1B, 45 }
+            , { KeyCode::C, 0x06, 46 }
+            , { KeyCode::V, 0x19, 47 }
+            , { KeyCode::B, 0x05, 48 }
+            , { KeyCode::N, 0x11, 49 }
+            , { KeyCode::M, 0x10, 50 }
+            , { KeyCode::COMMA, 0x36, 51 }
+            , { KeyCode::PERIOD, 0x37, 52 }
+            , { KeyCode::SLASH, 0x38, 53 }
+            , { KeyCode::RSHIFT, 0xE5, 54 }
+            , { KeyCode::MULTIPLY, 0x55, 55 }
+            , { KeyCode::LALT, 0xE2, 56 }
+            , { KeyCode::SPACE, 0x2C, 57 }
+            , { KeyCode::CAPITAL, 0x39, 58 }
+            , { KeyCode::F1, 0x3A, 59 }
+            , { KeyCode::F2, 0x3B, 60 }
+            , { KeyCode::F3, 0x3C, 61 }
+            , { KeyCode::F4, 0x3D, 62 }
+            , { KeyCode::F5, 0x3E, 63 }
+            , { KeyCode::F6, 0x3F, 64 }
+            , { KeyCode::F7, 0x40, 65 }
+            , { KeyCode::F8, 0x41, 66 }
+            , { KeyCode::F9, 0x42, 67 }
+            , { KeyCode::F10, 0x43, 68 }
+            , { KeyCode::NUMLOCK, 0x53, 69 }
+            , { KeyCode::SCROLL, 0x47, 70 }
+            , { KeyCode::NUMPAD7, 0x5F, 71 }
+            , { KeyCode::NUMPAD8, 0x60, 72 }
+            , { KeyCode::NUMPAD9, 0x61, 73 }
+            , { KeyCode::SUBTRACT, 0x56, 74 }
+            , { KeyCode::NUMPAD4, 0x5C, 75 }
+            , { KeyCode::NUMPAD5, 0x5D, 76 }
+            , { KeyCode::NUMPAD6, 0x5E, 77 }
+            , { KeyCode::ADD, 0x57, 78 }
+            , { KeyCode::NUMPAD1, 0x59, 79 }
+            , { KeyCode::NUMPAD2, 0x5A, 80 }
+            , { KeyCode::NUMPAD3, 0x5B, 81 }
+            , { KeyCode::NUMPAD0, 0x62, 82 }
+            , { KeyCode::DECIMAL, 0x63, 83 }
+            , { KeyCode::OEM_102, 0x64, 86 }
+            , { KeyCode::F11, 0x44, 87 }
+            , { KeyCode::F12, 0x45, 88 }
+            , { KeyCode::F13, 0x68, 183 }
+            , { KeyCode::F14, 0x69, 184 }
+            , { KeyCode::F15, 0x6A, 185 }
+            , { KeyCode::KANA, 0x88, 93 }
+            , { KeyCode::ABNT_C1, 0x87, 89 }
+            , { KeyCode::CONVERT, 0x8A, 92 }
+            , { KeyCode::NOCONVERT, 0x8B, 94 }
+            , { KeyCode::YEN, 0x89, 124 }
+            , { KeyCode::ABNT_C2, 0x85, 121 }
+            , { KeyCode::NUMPADEQUALS, 0x67, 117 }
+            // Media keys
+            , { KeyCode::PREVTRACK2, 0x00, 165 }
+            , { KeyCode::NEXTTRACK2, 0x00, 163 }
+            , { KeyCode::MUTE2, 0x7F, 113 }
+            , { KeyCode::CALCULATOR2, 0x00, 140 }
+            , { KeyCode::PLAYPAUSE2, 0x00, 164 }
+            , { KeyCode::MEDIASTOP2, 0x00, 166 }
+            , { KeyCode::VOLUMEDOWN2, 0x81, 114 }
+            , { KeyCode::VOLUMEUP2, 0x80, 115 }
+            , { KeyCode::WEBHOME2, 0x00, 172 }
+            , { KeyCode::POWER2, 0x66, 116 }
+            , { KeyCode::SLEEP2, 0x00, 142 }
+            , { KeyCode::WAKE2, 0x00, 143 }
+            , { KeyCode::WEBSEARCH2, 0x00, 217 }
+            , { KeyCode::WEBFAVORITES2, 0x00, 156 }
+            , { KeyCode::WEBREFRESH2, 0x00, 173 }
+            , { KeyCode::WEBSTOP2, 0x00, 128 }
+            , { KeyCode::WEBFORWARD2, 0x00, 159 }
+            , { KeyCode::WEBBACK2, 0x00, 158 }
+            , { KeyCode::MYCOMPUTER2, 0x00, 157 }
+            , { KeyCode::MAIL2, 0x00, 155 }
+            , { KeyCode::MEDIASELECT2, 0x00, 226 }
+            // Extended scan codes
+            , { KeyCode::KEYPADENTER, 0x58, 96 }
+            , { KeyCode::RCONTROL2, 0xE4, 97 }
+            , { KeyCode::KEYPADDIVIDE, 0x54, 98 }
+            , { KeyCode::CONTROLPRINTSCREEN, 0x46, 99 }
+            , { KeyCode::RIGHTALT, 0xE6, 100 }
+            , { KeyCode::GREYHOME, 0x4A, 102 }
+            , { KeyCode::GREYUP, 0x52, 103 }
+            , { KeyCode::GREYPGUP, 0x4B, 104 }
+            , { KeyCode::GREYLEFT, 0x50, 105 }
+            , { KeyCode::GREYRIGHT, 0x4F, 106 }
+            , { KeyCode::GREYEND, 0x4D, 107 }
+            , { KeyCode::GREYDOWN, 0x51, 108 }
+            , { KeyCode::GREYPGDN, 0x4E, 109 }
+            , { KeyCode::GREYINSERT, 0x49, 110 }
+            , { KeyCode::GREYDELETE, 0x4C, 111 }
+            , { KeyCode::PAUSE1, 0x48, 119 }
+            , { KeyCode::LEFTWINDOW, 0xE3, 125 }
+            , { KeyCode::RIGHTWINDOW, 0xE7, 126 }
+            , { KeyCode::MENU, 0x65, 127 }
+            // Aliases
+            , { KeyCode::NUMPADENTER, 0x58, 96 }
+            , { KeyCode::RCONTROL, 0xE4, 97 }
+            , { KeyCode::DIVIDE, 0x54, 98 }
+            , { KeyCode::SYSRQ, 0x46, 99 }
+            , { KeyCode::RALT, 0xE6, 100 }
+            , { KeyCode::HOME, 0x4A, 102 }
+            , { KeyCode::UP, 0x52, 103 }
+            , { KeyCode::PGUP, 0x4B, 104 }
+            , { KeyCode::LEFT, 0x50, 105 }
+            , { KeyCode::RIGHT, 0x4F, 106 }
+            , { KeyCode::END, 0x4D, 107 }
+            , { KeyCode::DOWN, 0x51, 108 }
+            , { KeyCode::PGDOWN, 0x4E, 109 }
+            , { KeyCode::INSERT, 0x49, 110 }
+            , { KeyCode::DELETE, 0x4C, 111 }
+            , { KeyCode::PAUSE, 0x48, 119 }
+            , { KeyCode::CONTROL2, 0x48, 119 } // Ctrl + Break
+            , { KeyCode::LWIN, 0xE3, 125 }
+            , { KeyCode::RWIN, 0xE7, 126 }
+            , { KeyCode::APPS, 0x65, 127 }
+            , { KeyCode::GREYNUMLOCK, 0x53, 69 }
+            , { KeyCode::NUMPADCOMMA, 0x85, 121 }
+            , { KeyCode::PREVTRACK, 0x00, 165 }
+            , { KeyCode::NEXTTRACK, 0x00, 163 }
+            , { KeyCode::MUTE, 0x7F, 113 }
+            , { KeyCode::CALCULATOR, 0x00, 140 }
+            , { KeyCode::PLAYPAUSE, 0x00, 164 }
+            , { KeyCode::MEDIASTOP, 0x00, 166 }
+            , { KeyCode::VOLUMEDOWN, 0x81, 114 }
+            , { KeyCode::VOLUMEUP, 0x80, 115 }
+            , { KeyCode::WEBHOME, 0x00, 172 }
+            , { KeyCode::POWER, 0x66, 116 }
+            , { KeyCode::SLEEP, 0x00, 142 }
+            , { KeyCode::WAKE, 0x00, 143 }
+            , { KeyCode::WEBSEARCH, 0x00, 217 }
+            , { KeyCode::WEBFAVORITES, 0x00, 156 }
+            , { KeyCode::WEBREFRESH, 0x00, 173 }
+            , { KeyCode::WEBSTOP, 0x00, 128 }
+            , { KeyCode::WEBFORWARD, 0x00, 159 }
+            , { KeyCode::WEBBACK, 0x00, 158 }
+            , { KeyCode::MYCOMPUTER, 0x00, 157 }
+            , { KeyCode::MAIL, 0x00, 155 }
+            , { KeyCode::MEDIASELECT, 0x00, 226 }
+            , { KeyCode::BACKSLASH, 0x32, 43 } // Non-US # and ~
+        };
+
+        constexpr size_t HidUsageCount = 256;
+        constexpr size_t EvdevCodeCount = 256;
+
+        struct KeyCodeTranslationTables
+        {
+            // Indexed by KeyIndex, KeyCodeIndex::InvalidIndex included so invalid key codes map to 0 without a branch.
+            std::array<uint8_t, 256> keyToHid{};
+            std::array<uint16_t, 256> keyToEvdev{};
+            std::array<KeyCode, HidUsageCount> hidToKey{};
+            std::array<KeyCode, EvdevCodeCount> evdevToKey{};
+        };
+
+        constexpr KeyCodeTranslationTables BuildKeyCodeTranslationTables()
+        {
+            KeyCodeTranslationTables tables{};
+            for (const KeyCodeTranslationEntry& entry : KeyCodeTranslationTable)
+            {
+                const KeyIndex index = KeyCodeIndex::ToIndex(entry.keyCode);
+                if (KeyCodeIndex::IsValid(index) == false || entry.evdevCode >= EvdevCodeCount)
+                    throw "Key code translation entry is out of range";
+
+                const size_t key = static_cast<size_t>(index);
+                if (tables.keyToHid[key] == 0)
+                    tables.keyToHid[key] = entry.hidUsage;
+                if (tables.keyToEvdev[key] == 0)
+                    tables.keyToEvdev[key] = entry.evdevCode;
+                if (entry.hidUsage != 0 && tables.hidToKey[entry.hidUsage] == KeyCode::UNASSIGNED)
+                    tables.hidToKey[entry.hidUsage] = entry.keyCode;
+                if (entry.evdevCode != 0 && tables.evdevToKey[entry.evdevCode] == KeyCode::UNASSIGNED)
+                    tables.evdevToKey[entry.evdevCode] = entry.keyCode;
+            }
+            return tables;
+        }
+
+        inline constexpr KeyCodeTranslationTables KeyCodeTranslationLookup = BuildKeyCodeTranslationTables();
+    }
+
+    /// <summary>
+    /// Translation between KeyCode (set 1 scan codes), USB HID keyboard usages (page 0x07) and Linux evdev KEY_* codes,
+    /// so any backend can produce a KeyCode without OS calls. Every translation is a table read, unmapped keys translate to 0 / KeyCode::UNASSIGNED.
+    /// Keys reported both as a DirectInput style code and an E0 prefixed scan code translate to the E0 prefixed one.
+    /// </summary>
+    class KeyCodeTranslation
+    {
+    public:
+        static constexpr uint8_t ToHidUsage(KeyCode keyCode)
+        {
+            return Detail::KeyCodeTranslationLookup.keyToHid[static_cast<size_t>(KeyCodeIndex::ToIndex(keyCode))];
+        }
+
+        static constexpr KeyCode FromHidUsage(uint8_t usage)
+        {
+            return Detail::KeyCodeTranslationLookup.hidToKey[usage];
+        }
+
+        static constexpr uint16_t ToEvdev(KeyCode keyCode)
+        {
+            return Detail::KeyCodeTranslationLookup.keyToEvdev[static_cast<size_t>(KeyCodeIndex::ToIndex(keyCode))];
+        }
+
+        static constexpr KeyCode FromEvdev(uint16_t code)
+        {
+            return code < Detail::EvdevCodeCount ? Detail::KeyCodeTranslationLookup.evdevToKey[code] : KeyCode::UNASSIGNED;
+        }
+    };
+
+    static_assert(KeyCodeTranslation::FromHidUsage(KeyCodeTranslation::ToHidUsage(KeyCode::RCONTROL)) == KeyCode::RCONTROL2, "KeyCodeTranslation mapping is broken");
+    static_assert(KeyCodeTranslation::FromEvdev(KeyCodeTranslation::ToEvdev(KeyCode::A)) == KeyCode::A, "KeyCodeTranslation mapping is broken");
+    static_assert(KeyCodeTranslation::FromEvdev(KeyCodeTranslation::ToEvdev(KeyCode::MUTE)) == KeyCode::MUTE2, "KeyCodeTranslation mapping is broken");
+}
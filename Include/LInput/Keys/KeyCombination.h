@@ -20,10 +20,19 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 #pragma once
+#include <algorithm>
+#include <array>
+#include <initializer_list>
+#include <iterator>
 #include <string>
+#include <string_view>
 #include <vector>
 #include "KeyCode.h"
 #include "KeyCodeHelper.h"
+#include "KeyCodeIndex.h"
+#include "KeyCodeNames.h"
+#include <LInput/Buttons/BitHelper.h>
+#include <LLUtils/Exception.h>
 #include <LLUtils/Warnings.h>
 
 #pragma pack(push, 1)
@@ -44,76 +53,180 @@ namespace LInput
             }
         };
 
-        bool operator ==( const KeyCombination& rhs) const
+        constexpr bool operator ==( const KeyCombination& rhs) const
         {
             return combinationID == rhs.combinationID;
         }
 
-        static ListKeyCombinations  FromString(const std::string& string)
+        /// <summary>
+        /// Parses a combination, e.g. "Control+Shift+A", "LAlt+F4", key names are case insensitive.
+        /// Side agnostic names (CONTROL, ALT, SHIFT, WINKEY and ENTER) are kept as a single spec with the matching 'any' flag set,
+        /// use Matches to test pressed keys against it.
+        /// Parsing is constexpr, see operator""_kc for combinations known at compile time.
+        /// </summary>
+        static constexpr KeyCombination FromString(std::string_view string)
         {
-            using namespace LLUtils;
-            std::string upper = StringUtility::ToUpper(string);
-
             KeyCombination combination;
-            using KeyCodeList = std::vector<KeyCode>;
-            using KeyCodeListList = std::vector<KeyCodeList>;
+            std::string_view badKey;
+            if (Parse(string, combination, badKey) == false)
+                LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, std::string("The key name '") + std::string(badKey) + "' could not be found");
 
-            KeyCodeListList duplicateCombinations2Darray;
+            return combination;
+        }
 
-            ListKeyCombinations bindings;
+        /// <summary>
+        /// Same as FromString, returns false instead of throwing, doesn't allocate.
+        /// </summary>
+        static constexpr bool TryParse(std::string_view string, KeyCombination& combination)
+        {
+            std::string_view badKey;
+            return Parse(string, combination, badKey);
+        }
 
+        /// <summary>
+        /// Builds a combination of concrete keys, sided modifiers set their modifier bit, the last other key is the key code.
+        /// See MakeCombination for combinations known at compile time.
+        /// </summary>
+        static constexpr KeyCombination FromKeys(std::initializer_list<KeyCode> keys)
+        {
+            KeyCombination combination;
+            for (KeyCode key : keys)
+            {
+                if (KeyCodeIndex::IsValid(KeyCodeIndex::ToIndex(key)) == false)
+                    LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "Unknown key code");
+                combination.AssignKey(key);
+            }
+            return combination;
+        }
 
-            ListAString keyCombination = StringUtility::split(upper, '+');
+        /// <summary>
+        /// Returns true if 'pressed', a combination of concrete keys, satisfies this spec:
+        /// sided modifiers must match exactly, except for side agnostic groups where at least one side must be pressed.
+        /// </summary>
+        bool Matches(KeyCombination pressed) const
+        {
+            const uint32_t groupLeftBits = GroupLeftBits((combinationID >> AnyShift) & AnyGroupsMask);
+            const uint32_t collapsed = groupLeftBits | (groupLeftBits << 1);
 
-            for (const std::string& key : keyCombination)
-            {
-                if (key == "CONTROL")
-                    duplicateCombinations2Darray.push_back({ KeyCode::LCONTROL, KeyCode::RCONTROL });
-                else if (key == "ALT")
-                    duplicateCombinations2Darray.push_back({ KeyCode::LALT, KeyCode::RALT });
-                else if (key == "SHIFT")
-                    duplicateCombinations2Darray.push_back({ KeyCode::LSHIFT, KeyCode::RSHIFT });
-                else if (key == "WINKEY")
-                    duplicateCombinations2Darray.push_back({ KeyCode::LWIN, KeyCode::RWIN });
-                else if (key == "ENTER")
-                    duplicateCombinations2Darray.push_back({ KeyCode::ENTERMAIN, KeyCode::KEYPADENTER });
-                else
-                {
-                    KeyCode keyCode = LInput::KeyCodeHelper::KeyNameToKeyCode(key);
-                    if (keyCode == KeyCode::UNASSIGNED)
-                        LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, std::string("The key name '") + key + "' could not be found");
-                    combination.AssignKey(keyCode);
-                }
+            const uint32_t pressedSided = (pressed.combinationID >> SidedShift) & 0xFFu;
+            const uint32_t pressedGroups = (pressedSided | (pressedSided >> 1)) & 0x55u;
+            const uint32_t sided = (combinationID >> SidedShift) & 0xFFu;
 
-            }
+            return (pressedSided & ~collapsed) == sided
+                && (pressedGroups & groupLeftBits) == groupLeftBits
+                && MatchesKeyCode(pressed.GetKeyCode());
+        }
 
-            if (duplicateCombinations2Darray.empty() == false)
-            {
-                using namespace std;
-                vector<size_t> sizes;
+        constexpr KeyCode GetKeyCode() const
+        {
+            return static_cast<KeyCode>(combinationID & KeyCodeMask);
+        }
 
-                for (const KeyCodeList& vec : duplicateCombinations2Darray)
-                    sizes.push_back(vec.size());
+        /// <summary>
+        /// Number of side agnostic flags, a spec with fewer is more specific.
+        /// </summary>
+        int GetAgnosticCount() const
+        {
+            return BitHelper::PopCount((combinationID >> AnyShift) & AnyMask);
+        }
 
-                vector<vector<size_t>> indices = KeyCodeHelper::ComputeCombinations(sizes);
+LLUTILS_DISABLE_WARNING_PUSH
+LLUTILS_DISABLE_WARNING_SWITCH_ENUM
+        /// <summary>
+        /// The combinationID bit of a sided modifier key, including the E0 prefixed scan codes raw input reports, 0 for any other key.
+        /// </summary>
+        static constexpr uint32_t ModifierBit(KeyCode keyCode)
+        {
+            switch (keyCode)
+            {
+            case KeyCode::LCONTROL:
+                return 1u << SidedShift;
+            case KeyCode::RCONTROL:
+            case KeyCode::RCONTROL2:
+                return 1u << (SidedShift + 1);
+            case KeyCode::LALT:
+                return 1u << (SidedShift + 2);
+            case KeyCode::RALT:
+            case KeyCode::RIGHTALT:
+                return 1u << (SidedShift + 3);
+            case KeyCode::LSHIFT:
+                return 1u << (SidedShift + 4);
+            case KeyCode::RSHIFT:
+                return 1u << (SidedShift + 5);
+            case KeyCode::LWIN:
+            case KeyCode::LEFTWINDOW:
+                return 1u << (SidedShift + 6);
+            case KeyCode::RWIN:
+            case KeyCode::RIGHTWINDOW:
+                return 1u << (SidedShift + 7);
+            default:
+                return 0;
+            }
+        }
+LLUTILS_DISABLE_WARNING_POP
 
-                for (const vector<size_t>& currentIndices : indices)
+        /// <summary>
+        /// Key code specs are grouped by, keys that a side agnostic spec may match share the same canonical key code.
+        /// </summary>
+        static KeyCode CanonicalKeyCode(KeyCode keyCode)
+        {
+            return keyCode == KeyCode::KEYPADENTER ? KeyCode::ENTERMAIN : keyCode;
+        }
+
+        /// <summary>
+        /// Writes the combination in the FromString format, e.g. "CONTROL+LSHIFT+A", to 'buffer' and null terminates it if 'size' allows.
+        /// Returns the length of the full string, which is truncated when it's not less than 'size'.
+        /// </summary>
+        size_t ToString(char* buffer, size_t size) const
+        {
+            size_t length = 0;
+            auto append = [&](std::string_view name)
+            {
+                if (length > 0)
                 {
-                    KeyCombination extraCombination = combination;
-                    for (size_t i = 0; i < currentIndices.size(); i++)
-                        extraCombination.AssignKey((duplicateCombinations2Darray[i])[currentIndices[i]]);
+                    if (length < size)
+                        buffer[length] = '+';
+                    length++;
+                }
 
-                    bindings.push_back(extraCombination);
+                for (char c : name)
+                {
+                    if (length < size)
+                        buffer[length] = c;
+                    length++;
                 }
-            }
-            else
+            };
+
+            const uint32_t anyFlags = (combinationID >> AnyShift) & AnyMask;
+            const uint32_t sided = (combinationID >> SidedShift) & 0xFFu;
+            for (size_t group = 0; group < std::size(ModifierGroups); group++)
             {
-                bindings.push_back(combination);
+                if ((anyFlags & (1u << group)) != 0)
+                    append(ModifierGroups[group].name);
+                if ((sided & (1u << (group * 2))) != 0)
+                    append(KeyCodeNames::ToName(ModifierGroups[group].left));
+                if ((sided & (1u << (group * 2 + 1))) != 0)
+                    append(KeyCodeNames::ToName(ModifierGroups[group].right));
             }
 
-            return bindings;
+            if ((anyFlags & AnyEnterBit) != 0)
+                append("ENTER");
+            else if (GetKeyCode() != KeyCode::UNASSIGNED)
+                append(KeyCodeNames::ToName(GetKeyCode()));
+
+            if (size > 0)
+                buffer[(std::min)(length, size - 1)] = '\0';
+
+            return length;
+        }
+
+        std::string ToString() const
+        {
+            std::array<char, MaxStringLength + 1> buffer;
+            const size_t length = ToString(buffer.data(), buffer.size());
+            return std::string(buffer.data(), (std::min)(length, MaxStringLength));
         }
-        std::string ToString();
+
 #ifdef _WIN32
         static KeyCombination FromVirtualKey(uint32_t key, uint32_t params)
         {
@@ -137,44 +250,97 @@ namespace LInput
         }
 #endif
      
-     LLUTILS_DISABLE_WARNING_PUSH 
-     LLUTILS_DISABLE_WARNING_SWITCH_ENUM
     private:
-        void AssignKey(KeyCode key)
-        {
-        switch (key)
-        {
-        case KeyCode::LALT:
-            keydata().leftAlt = 1;
-            break;
-        case KeyCode::RALT:
-            keydata().rightAlt = 1;
-            break;
-        case KeyCode::RCONTROL:
-            keydata().rightCtrl = 1;
-            break;
-        case KeyCode::LCONTROL:
-            keydata().leftCtrl = 1;
-            break;
-        case KeyCode::RSHIFT:
-            keydata().rightShift = 1;
-            break;
-        case KeyCode::LSHIFT:
-            keydata().leftShift = 1;
-            break;
-        case KeyCode::RWIN:
-            keydata().rightWinKey = 1;
-            break;
-        case KeyCode::LWIN:
-            keydata().leftWinKey = 1;
-            break;
-        default:
-            //Not a modifer - assign key.
-            keydata().keycode = key;
-            break;
+        struct ModifierGroup
+        {
+            std::string_view name;
+            KeyCode left;
+            KeyCode right;
+        };
+
+        /// <summary>
+        /// Side agnostic groups in the order of their 'any' flags, the sided keys in the order of their combinationID bits.
+        /// </summary>
+        static constexpr ModifierGroup ModifierGroups[]
+        {
+              { "CONTROL", KeyCode::LCONTROL, KeyCode::RCONTROL }
+            , { "ALT", KeyCode::LALT, KeyCode::RALT }
+            , { "SHIFT", KeyCode::LSHIFT, KeyCode::RSHIFT }
+            , { "WINKEY", KeyCode::LWIN, KeyCode::RWIN }
+        };
+
+        /// <summary>
+        /// Enough for all the modifiers and the longest key name.
+        /// </summary>
+        static constexpr size_t MaxStringLength = 128;
+
+        static constexpr bool Parse(std::string_view string, KeyCombination& combination, std::string_view& badKey)
+        {
+            combination = KeyCombination{};
+            for (size_t first = 0; first <= string.size();)
+            {
+                size_t last = string.find('+', first);
+                if (last == std::string_view::npos)
+                    last = string.size();
+
+                const std::string_view key = string.substr(first, last - first);
+                first = last + 1;
+
+                size_t group = 0;
+                while (group < std::size(ModifierGroups) && KeyCodeNames::EqualsIgnoreCase(key, ModifierGroups[group].name) == false)
+                    group++;
+
+                if (group < std::size(ModifierGroups))
+                {
+                    combination.combinationID |= 1u << (AnyShift + group);
+                }
+                else if (KeyCodeNames::EqualsIgnoreCase(key, "ENTER"))
+                {
+                    combination.AssignKey(KeyCode::ENTERMAIN);
+                    combination.combinationID |= AnyEnterBit << AnyShift;
+                }
+                else
+                {
+                    const KeyCode keyCode = KeyCodeNames::FromName(key);
+                    if (keyCode == KeyCode::UNASSIGNED)
+                    {
+                        badKey = key;
+                        return false;
+                    }
+                    combination.AssignKey(keyCode);
+                }
             }
+
+            // A side agnostic group already covers its sided keys, e.g. "Control+LControl".
+            const uint32_t groupLeftBits = GroupLeftBits((combination.combinationID >> AnyShift) & AnyGroupsMask);
+            combination.combinationID &= ~((groupLeftBits | (groupLeftBits << 1)) << SidedShift);
+            return true;
+        }
+
+        /// <summary>
+        /// Spreads the 4 side agnostic group bits to the left (even) bits of the sided modifiers byte, each group is a left/right bit pair.
+        /// </summary>
+        static constexpr uint32_t GroupLeftBits(uint32_t anyGroups)
+        {
+            const uint32_t spread = (anyGroups | (anyGroups << 2)) & 0x33u;
+            return (spread | (spread << 1)) & 0x55u;
+        }
+
+        bool MatchesKeyCode(KeyCode keyCode) const
+        {
+            const KeyCode own = GetKeyCode();
+            const bool anyEnter = ((combinationID >> AnyShift) & AnyEnterBit) != 0;
+            return own == keyCode || (anyEnter && CanonicalKeyCode(keyCode) == own);
+        }
+
+        constexpr void AssignKey(KeyCode key)
+        {
+            const uint32_t modifierBit = ModifierBit(key);
+            if (modifierBit != 0)
+                combinationID |= modifierBit;
+            else
+                combinationID = (combinationID & ~KeyCodeMask) | static_cast<uint16_t>(key); //Not a modifer - assign key.
         }
-LLUTILS_DISABLE_WARNING_POP
 
 #pragma region memeber fields
 #pragma pack(push,1)
@@ -192,9 +358,22 @@ LLUTILS_DISABLE_WARNING_POP
             unsigned char rightShift : 1;
             unsigned char leftWinKey : 1;
             unsigned char rightWinKey : 1;
-            unsigned char reserved : 8;
+            unsigned char anyCtrl : 1;
+            unsigned char anyAlt : 1;
+            unsigned char anyShift : 1;
+            unsigned char anyWinKey : 1;
+            unsigned char anyEnter : 1;
+            unsigned char reserved : 3;
         };
 #pragma pack(pop)
+        // Bit layout of combinationID, the flags are allocated from the least significant bit.
+        static constexpr uint32_t KeyCodeMask = 0xFFFF;
+        static constexpr uint32_t SidedShift = 16;
+        static constexpr uint32_t AnyShift = 24;
+        static constexpr uint32_t AnyGroupsMask = 0x0F;
+        static constexpr uint32_t AnyEnterBit = 0x10;
+        static constexpr uint32_t AnyMask = 0x1F;
+
         KeyCombinationFlags& keydata()
         {
 			static_assert(sizeof(uint32_t) == sizeof(KeyCombinationFlags), "Size mismatch");
@@ -203,6 +382,32 @@ LLUTILS_DISABLE_WARNING_POP
 
 #pragma endregion //memeber fields
     };
+
+    /// <summary>
+    /// A combination of concrete keys evaluated at compile time, e.g. MakeCombination<KeyCode::LCONTROL, KeyCode::S>().
+    /// </summary>
+    template <KeyCode... keys>
+    constexpr KeyCombination MakeCombination()
+    {
+        static_assert(sizeof...(keys) > 0, "A key combination needs at least one key");
+        static_assert((KeyCodeIndex::IsValid(KeyCodeIndex::ToIndex(keys)) && ...), "Unknown key code");
+        static_assert(((KeyCombination::ModifierBit(keys) == 0 ? 1 : 0) + ... + 0) <= 1, "A key combination has at most one key that is not a modifier");
+
+        constexpr KeyCombination combination = KeyCombination::FromKeys({ keys... });
+        return combination;
+    }
+
+    namespace Literals
+    {
+        /// <summary>
+        /// "CONTROL+SHIFT+S"_kc, parsed at compile time when it initializes a constexpr variable or a constant table,
+        /// an unknown key name is then a compile error.
+        /// </summary>
+        constexpr KeyCombination operator""_kc(const char* string, size_t length)
+        {
+            return KeyCombination::FromString(std::string_view(string, length));
+        }
+    }
 }
 
 #pragma pack(pop)
\ No newline at end of file
@@ -0,0 +1,333 @@
+/*
+Copyright (c) 2020 Lior Lahav
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <LLUtils/Exception.h>
+#include <LLUtils/StringUtility.h>
+#include <LInput/Timing/Clock.h>
+#include "KeyCombination.h"
+#include "PerfectHashIndex.h"
+#include "Span.h"
+
+namespace LInput
+{
+    using KeySequence = std::vector<KeyCombination>;
+
+    /// <summary>
+    /// Maps sequences of key combinations, e.g. "Control+K, Control+C", to bindings.
+    /// Sequences are stored in a trie, each edge is a combination spec bucketed by (node, canonical key code),
+    /// so a step costs one hash probe and a Matches test per spec in the bucket regardless of the number of sequences.
+    /// Freeze() flattens the trie into immutable arrays indexed with a perfect hash.
+    /// </summary>
+    template <class BindingType>
+    class KeySequenceBindings
+    {
+    public:
+        using NodeID = uint32_t;
+        static constexpr NodeID Root = 0;
+        static constexpr NodeID NoNode = (std::numeric_limits<NodeID>::max)();
+
+        /// <summary>
+        /// Parses a comma separated sequence of combinations, see KeyCombination::FromString.
+        /// </summary>
+        static KeySequence FromString(const std::string& string)
+        {
+            KeySequence sequence;
+            for (const std::string& stroke : LLUtils::StringUtility::split(string, ','))
+            {
+                const size_t first = stroke.find_first_not_of(' ');
+                const size_t last = stroke.find_last_not_of(' ');
+                if (first == std::string::npos)
+                    LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "empty key combination in sequence '" + string + "'");
+                sequence.push_back(KeyCombination::FromString(stroke.substr(first, last - first + 1)));
+            }
+            return sequence;
+        }
+
+        KeySequenceBindings()
+        {
+            mNodes.emplace_back();
+        }
+
+        void AddBinding(const KeySequence& sequence, const BindingType& binding)
+        {
+            if (sequence.empty())
+                LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "trying to add an empty key sequence");
+
+            mFrozen = false;
+            NodeID node = Root;
+            for (const KeyCombination& combination : sequence)
+            {
+                if (combination.GetKeyCode() == KeyCode::UNASSIGNED)
+                    LL_EXCEPTION(LLUtils::Exception::ErrorCode::LogicError, "trying to add an 'Unassigned' key binding");
+
+                std::vector<Edge>& edges = mEdges[EdgeKey(node, combination.GetKeyCode())];
+                auto it = std::find_if(edges.begin(), edges.end(), [&combination](const Edge& edge) { return edge.combination == combination; });
+                if (it == edges.end())
+                {
+                    // Most specific specs first, same as KeyBindings.
+                    auto position = std::upper_bound(edges.begin(), edges.end(), combination.GetAgnosticCount()
+                        , [](int agnosticCount, const Edge& edge) { return agnosticCount < edge.combination.GetAgnosticCount(); });
+                    const NodeID child = static_cast<NodeID>(mNodes.size());
+                    edges.insert(position, Edge{ combination, child });
+                    mNodes[node].childCount++;
+                    mNodes.emplace_back();
+                    node = child;
+                }
+                else
+                {
+                    node = it->child;
+                }
+            }
+
+            mNodes[node].bindings.push_back(binding);
+        }
+
+        /// <summary>
+        /// Flattens the trie into immutable arrays, steps use them until the next AddBinding.
+        /// </summary>
+        void Freeze()
+        {
+            std::vector<uint64_t> keys;
+            keys.reserve(mEdges.size());
+            for (const auto& [key, edges] : mEdges)
+                keys.push_back(key);
+
+            mFrozenIndex.Build(keys);
+            mFrozenSlots.assign(mFrozenIndex.TableSize(), FrozenSlot{});
+            mFrozenEdges.clear();
+            for (const auto& [key, edges] : mEdges)
+            {
+                FrozenSlot& slot = mFrozenSlots[mFrozenIndex.Slot(key)];
+                slot.key = key;
+                slot.edgeOffset = static_cast<uint32_t>(mFrozenEdges.size());
+                slot.edgeCount = static_cast<uint32_t>(edges.size());
+                mFrozenEdges.insert(mFrozenEdges.end(), edges.begin(), edges.end());
+            }
+
+            mFrozenNodes.clear();
+            mFrozenBindings.clear();
+            for (const Node& node : mNodes)
+            {
+                mFrozenNodes.push_back(FrozenNode{ static_cast<uint32_t>(mFrozenBindings.size()), static_cast<uint32_t>(node.bindings.size()), node.childCount });
+                mFrozenBindings.insert(mFrozenBindings.end(), node.bindings.begin(), node.bindings.end());
+            }
+
+            mFrozen = true;
+        }
+
+        bool IsFrozen() const
+        {
+            return mFrozen;
+        }
+
+        /// <summary>
+        /// The node reached from 'node' by the pressed keys in 'combination', NoNode if no sequence continues that way.
+        /// </summary>
+        NodeID Step(NodeID node, KeyCombination combination) const
+        {
+            const uint64_t key = EdgeKey(node, combination.GetKeyCode());
+            if (mFrozen)
+            {
+                const FrozenSlot& slot = mFrozenSlots[mFrozenIndex.Slot(key)];
+                if (slot.key != key)
+                    return NoNode;
+
+                for (uint32_t i = slot.edgeOffset; i < slot.edgeOffset + slot.edgeCount; i++)
+                    if (mFrozenEdges[i].combination.Matches(combination))
+                        return mFrozenEdges[i].child;
+                return NoNode;
+            }
+
+            auto it = mEdges.find(key);
+            if (it != mEdges.end())
+                for (const Edge& edge : it->second)
+                    if (edge.combination.Matches(combination))
+                        return edge.child;
+            return NoNode;
+        }
+
+        /// <summary>
+        /// Bindings of the sequence ending at 'node', valid until the next AddBinding or Freeze.
+        /// </summary>
+        Span<const BindingType> GetBindings(NodeID node) const
+        {
+            if (mFrozen)
+                return Span<const BindingType>(mFrozenBindings.data() + mFrozenNodes[node].bindingOffset, mFrozenNodes[node].bindingCount);
+            return Span<const BindingType>(mNodes[node].bindings.data(), mNodes[node].bindings.size());
+        }
+
+        bool HasContinuations(NodeID node) const
+        {
+            return (mFrozen ? mFrozenNodes[node].childCount : mNodes[node].childCount) != 0;
+        }
+
+    private:
+        struct Edge
+        {
+            KeyCombination combination;
+            NodeID child;
+        };
+
+        struct Node
+        {
+            std::vector<BindingType> bindings;
+            uint32_t childCount = 0;
+        };
+
+        struct FrozenSlot
+        {
+            // Key code 0 is never bound, so no edge key can collide with the empty slot key.
+            uint64_t key = 0;
+            uint32_t edgeOffset = 0;
+            uint32_t edgeCount = 0;
+        };
+
+        struct FrozenNode
+        {
+            uint32_t bindingOffset;
+            uint32_t bindingCount;
+            uint32_t childCount;
+        };
+
+        static uint64_t EdgeKey(NodeID node, KeyCode keyCode)
+        {
+            return (static_cast<uint64_t>(node) << 32) | static_cast<uint64_t>(KeyCombination::CanonicalKeyCode(keyCode));
+        }
+
+        std::vector<Node> mNodes;
+        std::unordered_map<uint64_t, std::vector<Edge>> mEdges;
+        bool mFrozen = false;
+        PerfectHashIndex mFrozenIndex;
+        std::vector<FrozenSlot> mFrozenSlots;
+        std::vector<Edge> mFrozenEdges;
+        std::vector<FrozenNode> mFrozenNodes;
+        std::vector<BindingType> mFrozenBindings;
+    };
+
+    /// <summary>
+    /// Per device position in a KeySequenceBindings trie.
+    /// Each pressed combination advances the cursor in O(1), a partial sequence is abandoned once its timeout elapses.
+    /// A sequence that is also the prefix of longer sequences completes immediately and the cursor stays in place to continue them.
+    /// </summary>
+    template <class BindingType>
+    class KeySequenceCursor
+    {
+    public:
+        using Bindings = KeySequenceBindings<BindingType>;
+        using NodeID = typename Bindings::NodeID;
+
+        enum class State { NoMatch, Partial, Complete };
+
+        struct Result
+        {
+            State state;
+            /// <summary>
+            /// Bindings of the completed sequence, empty unless state is Complete.
+            /// </summary>
+            Span<const BindingType> bindings;
+        };
+
+        /// <summary>
+        /// 'bindings' must outlive the cursor. 'timeoutMs' - maximum time between the strokes of a sequence.
+        /// </summary>
+        KeySequenceCursor(const Bindings& bindings, uint16_t timeoutMs) :
+              mBindings(bindings)
+            , mTimeout(timeoutMs * SteadyClock::TicksPerMillisecond)
+        {
+
+        }
+
+        /// <summary>
+        /// Advances the cursor with the pressed keys in 'combination' captured at 'timeStamp' (SteadyClock ticks).
+        /// A stroke that doesn't continue the current sequence is tried as the start of a new one.
+        /// </summary>
+        Result Feed(KeyCombination combination, SteadyClock::tick_type timeStamp)
+        {
+            if (timeStamp >= mDeadline)
+                Reset();
+
+            NodeID node = mBindings.Step(mNode, combination);
+            if (node == Bindings::NoNode && mNode != Bindings::Root)
+                node = mBindings.Step(Bindings::Root, combination);
+
+            if (node == Bindings::NoNode)
+            {
+                Reset();
+                return Result{ State::NoMatch, {} };
+            }
+
+            const Span<const BindingType> bindings = mBindings.GetBindings(node);
+            if (mBindings.HasContinuations(node))
+            {
+                mNode = node;
+                mDeadline = timeStamp + mTimeout;
+            }
+            else
+            {
+                Reset();
+            }
+
+            return bindings.empty() ? Result{ State::Partial, {} } : Result{ State::Complete, bindings };
+        }
+
+        /// <summary>
+        /// Time the current partial sequence times out, SteadyClock::NoDeadline at the root.
+        /// </summary>
+        SteadyClock::tick_type NextDeadline() const
+        {
+            return mDeadline;
+        }
+
+        /// <summary>
+        /// Abandons the current partial sequence if it timed out by 'now'.
+        /// </summary>
+        void Advance(SteadyClock::tick_type now)
+        {
+            if (now >= mDeadline)
+                Reset();
+        }
+
+        void Reset()
+        {
+            mNode = Bindings::Root;
+            mDeadline = SteadyClock::NoDeadline;
+        }
+
+        bool IsPartial() const
+        {
+            return mNode != Bindings::Root;
+        }
+
+    private:
+        const Bindings& mBindings;
+        SteadyClock::tick_type mTimeout;
+        NodeID mNode = Bindings::Root;
+        SteadyClock::tick_type mDeadline = SteadyClock::NoDeadline;
+    };
+}
@@ -0,0 +1,37 @@
+/*
+Copyright (c) 2020 Lior Lahav
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <LInput/Buttons/ButtonStates.h>
+#include "KeyCodeIndex.h"
+
+namespace LInput
+{
+    /// <summary>
+    /// Keyboard state indexed by KeyIndex, use KeyCodeIndex::ToIndex to convert a key code to a button.
+    /// </summary>
+    using DenseKeyboardState = ButtonsState<KeyIndex, KeyCodeIndex::Count>;
+
+    template <typename... Extensions>
+    using StaticDenseKeyboardState = StaticButtonsState<KeyIndex, KeyCodeIndex::Count, Extensions...>;
+}
@@ -0,0 +1,134 @@
+/*
+Copyright (c) 2020 Lior Lahav
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+#include <LLUtils/Exception.h>
+
+namespace LInput
+{
+    /// <summary>
+    /// Perfect hash over a fixed set of unique 64 bit keys, built with hash and displace:
+    /// keys are spread over small buckets and a seed is searched per bucket, largest bucket first,
+    /// until all its keys land on free slots. A lookup is one bucket seed read and two hashes, no probing.
+    /// Slot(key) of a key outside the set is an arbitrary slot, callers keep the key in the slot to verify hits.
+    /// </summary>
+    class PerfectHashIndex
+    {
+    public:
+        void Build(const std::vector<uint64_t>& keys)
+        {
+            std::vector<uint64_t> sorted = keys;
+            std::sort(sorted.begin(), sorted.end());
+            if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end())
+                LL_EXCEPTION(LLUtils::Exception::ErrorCode::DuplicateItem, "perfect hash keys must be unique");
+
+            size_t tableSize = 1;
+            // Load factor of at most 0.8 keeps the seed search short.
+            while (tableSize * 4 < keys.size() * 5)
+                tableSize *= 2;
+
+            while (TryBuild(keys, tableSize) == false)
+                tableSize *= 2;
+        }
+
+        size_t Slot(uint64_t key) const
+        {
+            const uint32_t seed = fSeeds[static_cast<size_t>(Hash(key, BucketSeed) % fSeeds.size())];
+            return static_cast<size_t>(Hash(key, seed)) & fMask;
+        }
+
+        size_t TableSize() const
+        {
+            return fMask + 1;
+        }
+
+        static uint64_t Hash(uint64_t key, uint32_t seed)
+        {
+            // splitmix64 finalizer
+            uint64_t x = key + (static_cast<uint64_t>(seed) + 1) * 0x9E3779B97F4A7C15ull;
+            x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+            x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+            return x ^ (x >> 31);
+        }
+
+    private:
+        static constexpr uint32_t MaxSeedAttempts = 1 << 16;
+        // Outside the range of bucket seeds, so bucket selection and slot hashing are independent.
+        static constexpr uint32_t BucketSeed = 0xFFFFFFFF;
+
+        bool TryBuild(const std::vector<uint64_t>& keys, size_t tableSize)
+        {
+            const size_t numBuckets = (std::max)(size_t{ 1 }, keys.size() / 4);
+            std::vector<std::vector<uint64_t>> buckets(numBuckets);
+            for (const uint64_t key : keys)
+                buckets[static_cast<size_t>(Hash(key, BucketSeed) % numBuckets)].push_back(key);
+
+            std::vector<size_t> order(numBuckets);
+            std::iota(order.begin(), order.end(), size_t{ 0 });
+            std::sort(order.begin(), order.end(), [&buckets](size_t lhs, size_t rhs) { return buckets[lhs].size() > buckets[rhs].size(); });
+
+            fMask = tableSize - 1;
+            fSeeds.assign(numBuckets, 0);
+            std::vector<bool> occupied(tableSize, false);
+            std::vector<size_t> slots;
+
+            for (const size_t bucketIndex : order)
+            {
+                const std::vector<uint64_t>& bucket = buckets[bucketIndex];
+                if (bucket.empty())
+                    break;
+
+                uint32_t seed = 0;
+                for (; seed < MaxSeedAttempts; seed++)
+                {
+                    slots.clear();
+                    for (const uint64_t key : bucket)
+                    {
+                        const size_t slot = static_cast<size_t>(Hash(key, seed)) & fMask;
+                        if (occupied[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end())
+                            break;
+                        slots.push_back(slot);
+                    }
+
+                    if (slots.size() == bucket.size())
+                        break;
+                }
+
+                if (seed == MaxSeedAttempts)
+                    return false;
+
+                for (const size_t slot : slots)
+                    occupied[slot] = true;
+                fSeeds[bucketIndex] = seed;
+            }
+            return true;
+        }
+
+        std::vector<uint32_t> fSeeds{ 0 };
+        size_t fMask = 0;
+    };
+}
@@ -0,0 +1,57 @@
+/*
+Copyright (c) 2020 Lior Lahav
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <cstddef>
+
+namespace LInput
+{
+    /// <summary>
+    /// Non owning view of a contiguous sequence, stays valid as long as the storage it views isn't modified.
+    /// </summary>
+    template <typename T>
+    class Span
+    {
+    public:
+        using element_type = T;
+        using iterator = T*;
+
+        constexpr Span() = default;
+        constexpr Span(T* data, size_t size) : fData(data), fSize(size) {}
+
+        template <size_t N>
+        constexpr Span(T(&array)[N]) : fData(array), fSize(N) {}
+
+        constexpr T* data() const { return fData; }
+        constexpr size_t size() const { return fSize; }
+        constexpr bool empty() const { return fSize == 0; }
+        constexpr T* begin() const { return fData; }
+        constexpr T* end() const { return fData + fSize; }
+        constexpr T& operator[](size_t index) const { return fData[index]; }
+        constexpr T& front() const { return fData[0]; }
+        constexpr T& back() const { return fData[fSize - 1]; }
+
+    private:
+        T* fData = nullptr;
+        size_t fSize = 0;
+    };
+}
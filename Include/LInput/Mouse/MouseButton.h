@@ -21,6 +21,7 @@ SOFTWARE.
 */
 
 #pragma once
+#include <cstdint>
 #include <vector>
 namespace LInput
 {
@@ -0,0 +1,201 @@
+/*
+Copyright (c) 2020 Lior Lahav
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+#include <LInput/Keys/PerfectHashIndex.h>
+
+namespace LInput
+{
+    /// <summary>
+    /// Devices keyed by their raw input handle, per device data is kept in dense slots.
+    /// Handles map to slots through a linear probing table, removal swaps the last slot into the hole
+    /// and shifts the probe chain back, so no tombstones are left and memory follows the number of live devices.
+    /// </summary>
+    template <typename device_type>
+    class DeviceRegistry
+    {
+    public:
+        using handle_type = uintptr_t;
+        static constexpr uint32_t NoSlot = std::numeric_limits<uint32_t>::max();
+
+        struct Entry
+        {
+            handle_type handle;
+            device_type device;
+        };
+
+        /// <summary>
+        /// Slot of 'handle', NoSlot if it's not registered. Slots change when a device is removed.
+        /// </summary>
+        uint32_t Find(handle_type handle) const
+        {
+            const size_t bucket = FindBucket(handle);
+            return bucket != NoBucket ? fTable[bucket] : NoSlot;
+        }
+
+        device_type* Get(handle_type handle)
+        {
+            const uint32_t slot = Find(handle);
+            return slot != NoSlot ? &fDevices[slot].device : nullptr;
+        }
+
+        /// <summary>
+        /// Registers 'handle', the device of an already registered handle is replaced.
+        /// </summary>
+        device_type& Add(handle_type handle, device_type device)
+        {
+            const uint32_t slot = Find(handle);
+            if (slot != NoSlot)
+            {
+                fDevices[slot].device = std::move(device);
+                return fDevices[slot].device;
+            }
+
+            // Load factor of at most 0.5 keeps probe chains short and guarantees an empty bucket.
+            if ((fDevices.size() + 1) * 2 > fTable.size())
+                Rehash((std::max)(MinTableSize, fTable.size() * 2));
+
+            fDevices.push_back(Entry{ handle, std::move(device) });
+            Insert(handle, static_cast<uint32_t>(fDevices.size() - 1));
+            return fDevices.back().device;
+        }
+
+        bool Remove(handle_type handle)
+        {
+            const size_t bucket = FindBucket(handle);
+            if (bucket == NoBucket)
+                return false;
+
+            const uint32_t slot = fTable[bucket];
+            EraseBucket(bucket);
+
+            const uint32_t lastSlot = static_cast<uint32_t>(fDevices.size() - 1);
+            if (slot != lastSlot)
+            {
+                fTable[FindBucket(fDevices[lastSlot].handle)] = slot;
+                fDevices[slot] = std::move(fDevices[lastSlot]);
+            }
+
+            fDevices.pop_back();
+            return true;
+        }
+
+        void clear()
+        {
+            fDevices.clear();
+            std::fill(fTable.begin(), fTable.end(), NoSlot);
+        }
+
+        size_t size() const
+        {
+            return fDevices.size();
+        }
+
+        bool empty() const
+        {
+            return fDevices.empty();
+        }
+
+        Entry& operator[](uint32_t slot)
+        {
+            return fDevices[slot];
+        }
+
+        const Entry& operator[](uint32_t slot) const
+        {
+            return fDevices[slot];
+        }
+
+        typename std::vector<Entry>::iterator begin() { return fDevices.begin(); }
+        typename std::vector<Entry>::iterator end() { return fDevices.end(); }
+        typename std::vector<Entry>::const_iterator begin() const { return fDevices.begin(); }
+        typename std::vector<Entry>::const_iterator end() const { return fDevices.end(); }
+
+    private:
+        static constexpr size_t MinTableSize = 16;
+        static constexpr size_t NoBucket = std::numeric_limits<size_t>::max();
+
+        size_t HomeBucket(handle_type handle) const
+        {
+            return static_cast<size_t>(PerfectHashIndex::Hash(handle, 0)) & fMask;
+        }
+
+        size_t FindBucket(handle_type handle) const
+        {
+            if (fDevices.empty())
+                return NoBucket;
+
+            for (size_t bucket = HomeBucket(handle); ; bucket = (bucket + 1) & fMask)
+            {
+                const uint32_t slot = fTable[bucket];
+                if (slot == NoSlot)
+                    return NoBucket;
+                if (fDevices[slot].handle == handle)
+                    return bucket;
+            }
+        }
+
+        void Insert(handle_type handle, uint32_t slot)
+        {
+            size_t bucket = HomeBucket(handle);
+            while (fTable[bucket] != NoSlot)
+                bucket = (bucket + 1) & fMask;
+            fTable[bucket] = slot;
+        }
+
+        /// <summary>
+        /// Backward shift deletion, entries after the hole move back unless their home bucket lies between the hole and them.
+        /// </summary>
+        void EraseBucket(size_t hole)
+        {
+            for (size_t bucket = (hole + 1) & fMask; fTable[bucket] != NoSlot; bucket = (bucket + 1) & fMask)
+            {
+                const size_t home = HomeBucket(fDevices[fTable[bucket]].handle);
+                if (((bucket - home) & fMask) >= ((bucket - hole) & fMask))
+                {
+                    fTable[hole] = fTable[bucket];
+                    hole = bucket;
+                }
+            }
+
+            fTable[hole] = NoSlot;
+        }
+
+        void Rehash(size_t tableSize)
+        {
+            fTable.assign(tableSize, NoSlot);
+            fMask = tableSize - 1;
+            for (size_t slot = 0; slot < fDevices.size(); slot++)
+                Insert(fDevices[slot].handle, static_cast<uint32_t>(slot));
+        }
+
+        std::vector<Entry> fDevices;
+        std::vector<uint32_t> fTable;
+        size_t fMask = 0;
+    };
+}
@@ -0,0 +1,378 @@
+/*
+Copyright (c) 2020 Lior Lahav
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <LLUtils/Exception.h>
+#include <LInput/Buttons/ButtonState.h>
+#include <LInput/Keys/KeyCodeHelper.h>
+#include <LInput/Timing/Clock.h>
+
+namespace LInput
+{
+    /// <summary>
+    /// Layout of the packed RAWINPUT records returned by GetRawInputData and GetRawInputBuffer, mirrored so records can be decoded without Windows.h.
+    /// Handles are pointer sized, as in the native process.
+    /// </summary>
+    namespace RawInputRecord
+    {
+        enum Type : uint32_t
+        {
+              TypeMouse     = 0 // RIM_TYPEMOUSE
+            , TypeKeyboard  = 1 // RIM_TYPEKEYBOARD
+            , TypeHid       = 2 // RIM_TYPEHID
+        };
+
+        enum KeyboardFlags : uint16_t
+        {
+              KeyBreak  = 0x01 // RI_KEY_BREAK
+            , KeyE0     = 0x02 // RI_KEY_E0
+            , KeyE1     = 0x04 // RI_KEY_E1
+        };
+
+        constexpr uint16_t MouseWheel = 0x0400; // RI_MOUSE_WHEEL
+        constexpr int16_t WheelDelta = 120;     // WHEEL_DELTA
+
+        /// <summary>
+        /// RAWINPUTHEADER, 'size' is the size of the whole record.
+        /// </summary>
+        struct Header
+        {
+            uint32_t type;
+            uint32_t size;
+            uintptr_t device;
+            uintptr_t wParam;
+        };
+
+        /// <summary>
+        /// RAWMOUSE
+        /// </summary>
+        struct Mouse
+        {
+            uint16_t flags;
+            uint16_t padding;
+            uint16_t buttonFlags;
+            uint16_t buttonData;
+            uint32_t rawButtons;
+            int32_t lastX;
+            int32_t lastY;
+            uint32_t extraInformation;
+        };
+
+        /// <summary>
+        /// RAWKEYBOARD
+        /// </summary>
+        struct Keyboard
+        {
+            uint16_t makeCode;
+            uint16_t flags;
+            uint16_t reserved;
+            uint16_t vKey;
+            uint32_t message;
+            uint32_t extraInformation;
+        };
+
+        /// <summary>
+        /// RAWHID, followed by 'count' reports of 'sizeHid' bytes each.
+        /// </summary>
+        struct Hid
+        {
+            uint32_t sizeHid;
+            uint32_t count;
+        };
+
+        /// <summary>
+        /// RAWINPUTHEADER as GetRawInputBuffer returns it to a 32 bit process on 64 bit Windows.
+        /// </summary>
+        struct Header64
+        {
+            uint32_t type;
+            uint32_t size;
+            uint64_t device;
+            uint64_t wParam;
+        };
+
+        /// <summary>
+        /// Native - the layout of the process, Wow64 - 64 bit headers and alignment, returned by GetRawInputBuffer under WOW64.
+        /// GetRawInputData always returns the native layout.
+        /// </summary>
+        enum class Layout { Native, Wow64 };
+
+        constexpr size_t HeaderSize(Layout layout)
+        {
+            return layout == Layout::Wow64 ? sizeof(Header64) : sizeof(Header);
+        }
+
+        /// <summary>
+        /// GetRawInputBuffer aligns every record to the size of a pointer, see NEXTRAWINPUTBLOCK.
+        /// </summary>
+        constexpr size_t Alignment(Layout layout)
+        {
+            return layout == Layout::Wow64 ? sizeof(uint64_t) : sizeof(uintptr_t);
+        }
+
+        constexpr size_t AlignSize(size_t size, Layout layout = Layout::Native)
+        {
+            return (size + Alignment(layout) - 1) & ~(Alignment(layout) - 1);
+        }
+    }
+
+    struct RawMouseInput
+    {
+        uintptr_t device;
+        /// <summary>
+        /// Capture time of the record, see RawInputDecoder::Decode.
+        /// </summary>
+        SteadyClock::tick_type timeStamp;
+        int32_t deltaX;
+        int32_t deltaY;
+        int16_t wheelDelta;
+        /// <summary>
+        /// set bit - button is down
+        /// </summary>
+        uint8_t buttonState;
+        /// <summary>
+        /// set bit - the state of the button is reported in 'buttonState'
+        /// </summary>
+        uint8_t buttonStateValid;
+    };
+
+    struct RawKeyboardInput
+    {
+        uintptr_t device;
+        SteadyClock::tick_type timeStamp;
+        KeyCode keyCode;
+        ButtonState state;
+    };
+
+    /// <summary>
+    /// A single HID report, 'report' points into the decoded buffer.
+    /// </summary>
+    struct RawHidInput
+    {
+        uintptr_t device;
+        SteadyClock::tick_type timeStamp;
+        const uint8_t* report;
+        uint32_t size;
+    };
+
+    /// <summary>
+    /// Typed events of a decoded buffer, 'order' holds the arrival order across the event types.
+    /// Kept by the decoder and reused, so decoding a buffer doesn't allocate once the capacity is reached.
+    /// </summary>
+    struct RawInputBatch
+    {
+        enum class EventType : uint8_t { Mouse, Keyboard, Hid };
+
+        struct Entry
+        {
+            EventType type;
+            uint32_t index;
+        };
+
+        std::vector<Entry> order;
+        std::vector<RawMouseInput> mouse;
+        std::vector<RawKeyboardInput> keyboard;
+        std::vector<RawHidInput> hid;
+
+        bool empty() const
+        {
+            return order.empty();
+        }
+
+        void clear()
+        {
+            order.clear();
+            mouse.clear();
+            keyboard.clear();
+            hid.clear();
+        }
+    };
+
+    /// <summary>
+    /// Decodes a buffer of packed RAWINPUT records into a RawInputBatch in a single pass, independent of the Win32 message pump.
+    /// </summary>
+    class RawInputDecoder
+    {
+    public:
+        static constexpr size_t MaxMouseButtons = 8;
+
+        /// <summary>
+        /// Decodes up to 'maxRecords' records from 'buffer', e.g. the count returned by GetRawInputBuffer.
+        /// Records of devices without a handle and of unknown types are skipped.
+        /// 'timeStamp' - time the records were received, e.g. when WM_INPUT arrived or the buffer was drained, events carry it
+        /// so repeat and multipress timing doesn't depend on when they are processed.
+        /// The batch is valid until the next call, HID reports point into 'buffer'.
+        /// </summary>
+        const RawInputBatch& Decode(const uint8_t* buffer, size_t size, SteadyClock::tick_type timeStamp, size_t maxRecords = SIZE_MAX
+            , RawInputRecord::Layout layout = RawInputRecord::Layout::Native)
+        {
+            fBatch.clear();
+            fTimeStamp = timeStamp;
+
+            const size_t headerSize = RawInputRecord::HeaderSize(layout);
+            size_t offset = 0;
+            for (size_t record = 0; record < maxRecords && offset < size; record++)
+            {
+                const RawInputRecord::Header header = ReadHeader(buffer + offset, size - offset, layout);
+                if (header.size < headerSize || header.size > size - offset)
+                    LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "truncated raw input record");
+
+                const uint8_t* data = buffer + offset + headerSize;
+                const size_t dataSize = header.size - headerSize;
+
+                if (header.device != 0) // Fix trackpad issues in laptops
+                {
+                    switch (header.type)
+                    {
+                    case RawInputRecord::TypeMouse:
+                        DecodeMouse(header, data, dataSize);
+                        break;
+                    case RawInputRecord::TypeKeyboard:
+                        DecodeKeyboard(header, data, dataSize);
+                        break;
+                    case RawInputRecord::TypeHid:
+                        DecodeHid(header, data, dataSize);
+                        break;
+                    default:
+                        break;
+                    }
+                }
+
+                offset += RawInputRecord::AlignSize(header.size, layout);
+            }
+
+            return fBatch;
+        }
+
+        const RawInputBatch& GetBatch() const
+        {
+            return fBatch;
+        }
+
+    private:
+        template <typename T>
+        static T Read(const uint8_t* data, size_t size)
+        {
+            if (size < sizeof(T))
+                LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "truncated raw input record");
+
+            T value;
+            std::memcpy(&value, data, sizeof(T));
+            return value;
+        }
+
+        /// <summary>
+        /// The header in the native layout, 64 bit handles of a WOW64 header fit in 32 bits.
+        /// </summary>
+        static RawInputRecord::Header ReadHeader(const uint8_t* data, size_t size, RawInputRecord::Layout layout)
+        {
+            if (layout == RawInputRecord::Layout::Native)
+                return Read<RawInputRecord::Header>(data, size);
+
+            const RawInputRecord::Header64 header = Read<RawInputRecord::Header64>(data, size);
+            return RawInputRecord::Header{ header.type, header.size, static_cast<uintptr_t>(header.device), static_cast<uintptr_t>(header.wParam) };
+        }
+
+        void Push(RawInputBatch::EventType type, size_t index)
+        {
+            fBatch.order.push_back(RawInputBatch::Entry{ type, static_cast<uint32_t>(index) });
+        }
+
+        void DecodeMouse(const RawInputRecord::Header& header, const uint8_t* data, size_t size)
+        {
+            const RawInputRecord::Mouse mouse = Read<RawInputRecord::Mouse>(data, size);
+
+            RawMouseInput evnt{};
+            evnt.device = header.device;
+            evnt.timeStamp = fTimeStamp;
+            evnt.deltaX = mouse.lastX;
+            evnt.deltaY = mouse.lastY;
+            if (mouse.buttonFlags == RawInputRecord::MouseWheel)
+            {
+                evnt.wheelDelta = static_cast<int16_t>(static_cast<int16_t>(mouse.buttonData) / RawInputRecord::WheelDelta);
+            }
+            else
+            {
+                for (size_t i = 0; i < MaxMouseButtons; i++)
+                {
+                    const uint8_t buttonMask = static_cast<uint8_t>(1u << i);
+
+                    if (mouse.buttonFlags & (1ul << (i * 2)))
+                    {
+                        evnt.buttonState |= buttonMask;
+                        evnt.buttonStateValid |= buttonMask;
+                    }
+
+                    if (mouse.buttonFlags & (2ul << (i * 2)))
+                    {
+                        evnt.buttonState &= static_cast<uint8_t>(~buttonMask);
+                        evnt.buttonStateValid |= buttonMask;
+                    }
+                }
+            }
+
+            Push(RawInputBatch::EventType::Mouse, fBatch.mouse.size());
+            fBatch.mouse.push_back(evnt);
+        }
+
+        void DecodeKeyboard(const RawInputRecord::Header& header, const uint8_t* data, size_t size)
+        {
+            const RawInputRecord::Keyboard keyboard = Read<RawInputRecord::Keyboard>(data, size);
+
+            RawKeyboardInput evnt{};
+            evnt.device = header.device;
+            evnt.timeStamp = fTimeStamp;
+            evnt.keyCode = KeyCodeHelper::KeyCodeFromScanCode(keyboard.makeCode
+                , (keyboard.flags & RawInputRecord::KeyE0) != 0, (keyboard.flags & RawInputRecord::KeyE1) != 0);
+            evnt.state = (keyboard.flags & RawInputRecord::KeyBreak) != 0 ? ButtonState::Up : ButtonState::Down;
+
+            Push(RawInputBatch::EventType::Keyboard, fBatch.keyboard.size());
+            fBatch.keyboard.push_back(evnt);
+        }
+
+        /// <summary>
+        /// A record may hold several reports of the same size, each is a separate event.
+        /// </summary>
+        void DecodeHid(const RawInputRecord::Header& header, const uint8_t* data, size_t size)
+        {
+            const RawInputRecord::Hid hid = Read<RawInputRecord::Hid>(data, size);
+            const uint8_t* report = data + sizeof(RawInputRecord::Hid);
+            const size_t reportsSize = size - sizeof(RawInputRecord::Hid);
+
+            if (hid.sizeHid != 0 && hid.count > reportsSize / hid.sizeHid)
+                LL_EXCEPTION(LLUtils::Exception::ErrorCode::BadParameters, "truncated raw input record");
+
+            for (uint32_t i = 0; i < hid.count && hid.sizeHid != 0; i++, report += hid.sizeHid)
+            {
+                Push(RawInputBatch::EventType::Hid, fBatch.hid.size());
+                fBatch.hid.push_back(RawHidInput{ header.device, fTimeStamp, report, hid.sizeHid });
+            }
+        }
+
+        RawInputBatch fBatch;
+        SteadyClock::tick_type fTimeStamp = 0;
+    };
+}
@@ -0,0 +1,54 @@
+/*
+Copyright (c) 2020 Lior Lahav
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <limits>
+
+namespace LInput
+{
+	/// <summary>
+	/// Monotonic nanosecond time base and the default clock policy of the extensions.
+	/// A clock policy is any type with a static Now() returning the current time in nanoseconds as SteadyClock::tick_type,
+	/// extension timestamps and deadlines are in ticks of their clock policy so a host loop can compare them against its Now().
+	/// </summary>
+	class SteadyClock
+	{
+	public:
+		using tick_type = uint64_t;
+		static constexpr tick_type NoDeadline = (std::numeric_limits<tick_type>::max)();
+		static constexpr tick_type TicksPerMillisecond = 1'000'000;
+
+		static tick_type Now()
+		{
+			using namespace std::chrono;
+			return static_cast<tick_type>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+		}
+	};
+
+	/// <summary>
+	/// Passed as the source timestamp of a button transition to have the extension read its clock instead.
+	/// Outside the range of any clock, so a replay or simulation clock may start at 0.
+	/// </summary>
+	inline constexpr SteadyClock::tick_type TimeStampNow = SteadyClock::NoDeadline;
+}
@@ -0,0 +1,179 @@
+/*
+Copyright (c) 2020 Lior Lahav
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <LInput/Timing/Clock.h>
+#include <LInput/Timing/TimerWheel.h>
+
+namespace LInput
+{
+	/// <summary>
+	/// Process wide timer service, a single thread drives one TimerWheel with a resolution of one millisecond
+	/// on behalf of all the devices and extensions.
+	/// Callbacks are invoked on the service thread while holding the service lock, a callback may schedule and cancel timers.
+	/// </summary>
+	class TimerService
+	{
+	public:
+		using Callback = std::function<void()>;
+		using clock_type = std::chrono::steady_clock;
+
+		class Timer
+		{
+		public:
+			explicit Timer(Callback callback, TimerService& service = TimerService::Instance()) :
+				fService(service)
+				, fTimer(std::move(callback))
+			{
+
+			}
+
+			~Timer()
+			{
+				Cancel();
+			}
+
+			Timer(const Timer&) = delete;
+			Timer& operator=(const Timer&) = delete;
+
+			/// <summary>
+			/// Fires the timer once, 'delayMs' milliseconds from now, re-schedules the timer if it's already scheduled.
+			/// </summary>
+			void Schedule(uint32_t delayMs)
+			{
+				fService.ScheduleAt(fTimer, SteadyClock::Now() + delayMs * SteadyClock::TicksPerMillisecond);
+			}
+
+			/// <summary>
+			/// Fires the timer once, no earlier than the SteadyClock time 'deadline', re-schedules the timer if it's already scheduled.
+			/// </summary>
+			void ScheduleAt(SteadyClock::tick_type deadline)
+			{
+				fService.ScheduleAt(fTimer, deadline);
+			}
+
+			/// <summary>
+			/// Cancels the timer, once Cancel returns the callback is guaranteed not to be running on the service thread,
+			/// unless Cancel is called from the callback itself.
+			/// </summary>
+			void Cancel()
+			{
+				fService.Cancel(fTimer);
+			}
+
+			/// <summary>
+			/// The service lock, callbacks run while it's held. Other threads hold it to modify state a callback uses.
+			/// </summary>
+			std::unique_lock<std::recursive_mutex> Lock() const
+			{
+				return std::unique_lock<std::recursive_mutex>(fService.fMutex);
+			}
+
+			bool IsScheduled() const
+			{
+				std::lock_guard<std::recursive_mutex> lock(fService.fMutex);
+				return fTimer.IsScheduled();
+			}
+
+		private:
+			TimerService& fService;
+			TimerWheel::Timer fTimer;
+		};
+
+		static TimerService& Instance()
+		{
+			static TimerService instance;
+			return instance;
+		}
+
+		~TimerService()
+		{
+			{
+				std::lock_guard<std::recursive_mutex> lock(fMutex);
+				fExit = true;
+			}
+			fCondition.notify_one();
+			fThread.join();
+		}
+
+		TimerService(const TimerService&) = delete;
+		TimerService& operator=(const TimerService&) = delete;
+
+	private:
+		TimerService() : fWheel(NowTick())
+		{
+			fThread = std::thread(&TimerService::ThreadProc, this);
+		}
+
+		static TimerWheel::tick_type NowTick()
+		{
+			return SteadyClock::Now() / SteadyClock::TicksPerMillisecond;
+		}
+
+		void ScheduleAt(TimerWheel::Timer& timer, SteadyClock::tick_type deadline)
+		{
+			std::lock_guard<std::recursive_mutex> lock(fMutex);
+			// Round up, a timer never fires before its deadline.
+			const TimerWheel::tick_type tick = (deadline + SteadyClock::TicksPerMillisecond - 1) / SteadyClock::TicksPerMillisecond;
+			fWheel.Schedule(timer, tick);
+			// Wake the service thread only if it's sleeping past the new deadline.
+			if (tick < fWakeUpTick)
+			{
+				fWakeUpTick = tick;
+				fCondition.notify_one();
+			}
+		}
+
+		void Cancel(TimerWheel::Timer& timer)
+		{
+			std::lock_guard<std::recursive_mutex> lock(fMutex);
+			fWheel.Cancel(timer);
+		}
+
+		void ThreadProc()
+		{
+			std::unique_lock<std::recursive_mutex> lock(fMutex);
+			while (fExit == false)
+			{
+				fWheel.Advance(NowTick());
+				fWakeUpTick = fWheel.NextDeadline();
+				if (fWakeUpTick == TimerWheel::NoDeadline)
+					fCondition.wait(lock);
+				else
+					fCondition.wait_until(lock, clock_type::time_point(std::chrono::milliseconds(fWakeUpTick)));
+			}
+		}
+
+		mutable std::recursive_mutex fMutex;
+		std::condition_variable_any fCondition;
+		TimerWheel fWheel;
+		TimerWheel::tick_type fWakeUpTick = TimerWheel::NoDeadline;
+		bool fExit = false;
+		std::thread fThread;
+	};
+}
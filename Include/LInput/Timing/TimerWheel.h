@@ -0,0 +1,311 @@
+/*
+Copyright (c) 2020 Lior Lahav
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <LInput/Buttons/BitHelper.h>
+
+namespace LInput
+{
+	/// <summary>
+	/// Hierarchical timing wheel, 4 levels of 64 slots.
+	/// Level 0 holds timers due within 64 ticks, each higher level covers 64 times the range of the level below it,
+	/// timers are cascaded down a level when their slot comes up.
+	/// Schedule and Cancel are O(1), the next deadline is found with one bit scan per level.
+	/// The wheel is not thread safe, see TimerService for a threaded host.
+	/// </summary>
+	class TimerWheel
+	{
+	public:
+		using tick_type = uint64_t;
+		static constexpr tick_type NoDeadline = (std::numeric_limits<tick_type>::max)();
+
+		class Timer
+		{
+		public:
+			using Callback = std::function<void()>;
+
+			Timer() = default;
+			explicit Timer(Callback callback) : fCallback(std::move(callback)) {}
+
+			~Timer()
+			{
+				if (fWheel != nullptr)
+					fWheel->Cancel(*this);
+			}
+
+			Timer(const Timer&) = delete;
+			Timer& operator=(const Timer&) = delete;
+
+			void SetCallback(Callback callback)
+			{
+				fCallback = std::move(callback);
+			}
+
+			bool IsScheduled() const
+			{
+				return fWheel != nullptr;
+			}
+
+			tick_type GetDeadline() const
+			{
+				return fDeadline;
+			}
+
+		private:
+			friend class TimerWheel;
+			static constexpr uint16_t NotLinked = (std::numeric_limits<uint16_t>::max)();
+
+			Timer* fPrev = nullptr;
+			Timer* fNext = nullptr;
+			TimerWheel* fWheel = nullptr;
+			tick_type fDeadline = 0;
+			uint16_t fSlot = NotLinked;
+			Callback fCallback;
+		};
+
+		explicit TimerWheel(tick_type now = 0) : fCurrent(now) {}
+
+		~TimerWheel()
+		{
+			for (Timer* head : fSlots)
+				for (Timer* timer = head; timer != nullptr; timer = timer->fNext)
+				{
+					timer->fWheel = nullptr;
+					timer->fSlot = Timer::NotLinked;
+				}
+		}
+
+		TimerWheel(const TimerWheel&) = delete;
+		TimerWheel& operator=(const TimerWheel&) = delete;
+
+		/// <summary>
+		/// Schedules 'timer' to fire at 'deadline', re-schedules it if it's already scheduled.
+		/// Deadlines before GetCurrentTick() are treated as due at GetCurrentTick().
+		/// </summary>
+		void Schedule(Timer& timer, tick_type deadline)
+		{
+			Cancel(timer);
+			timer.fDeadline = deadline;
+			timer.fWheel = this;
+			fCount++;
+			Place(timer);
+		}
+
+		void Cancel(Timer& timer)
+		{
+			if (timer.fWheel != this)
+				return;
+
+			Unlink(timer);
+			timer.fWheel = nullptr;
+			fCount--;
+		}
+
+		bool empty() const
+		{
+			return fCount == 0;
+		}
+
+		size_t size() const
+		{
+			return fCount;
+		}
+
+		/// <summary>
+		/// The next tick to be processed, all timers with an earlier deadline have fired.
+		/// </summary>
+		tick_type GetCurrentTick() const
+		{
+			return fCurrent;
+		}
+
+		/// <summary>
+		/// Returns the tick at which Advance has work to do: exact for timers due within 64 ticks,
+		/// otherwise a lower bound - the tick at which the earliest occupied higher level slot is cascaded.
+		/// Returns NoDeadline if no timer is scheduled.
+		/// </summary>
+		tick_type NextDeadline() const
+		{
+			tick_type next = NoDeadline;
+			for (size_t level = 0; level < Levels; level++)
+			{
+				const uint64_t occupied = fOccupied[level];
+				if (occupied == 0)
+					continue;
+
+				const size_t shift = level * SlotBits;
+				const size_t currentIndex = static_cast<size_t>((fCurrent >> shift) & SlotMask);
+				const uint64_t rotated = (occupied >> currentIndex) | (currentIndex == 0 ? 0 : occupied << (SlotsPerLevel - currentIndex));
+				tick_type offset = static_cast<tick_type>(BitHelper::CountTrailingZeros(rotated));
+				tick_type due;
+
+				if (level == 0)
+				{
+					due = fCurrent + offset;
+				}
+				else
+				{
+					// The current slot of a higher level is cascaded at the start of its range, if that tick is yet to be processed,
+					// otherwise it's next cascaded a full revolution later and the next occupied slot, if any, comes first.
+					if (offset == 0 && (fCurrent & ((tick_type{ 1 } << shift) - 1)) != 0)
+					{
+						const uint64_t others = rotated & ~uint64_t{ 1 };
+						offset = others != 0 ? static_cast<tick_type>(BitHelper::CountTrailingZeros(others)) : SlotsPerLevel;
+					}
+
+					due = ((fCurrent >> shift) + offset) << shift;
+				}
+
+				next = (std::min)(next, due);
+			}
+			return next;
+		}
+
+		/// <summary>
+		/// Fires every timer with a deadline up to and including 'now', returns the number of timers fired.
+		/// Callbacks may schedule and cancel timers, a timer scheduled by a callback at or before 'now' fires in the same call.
+		/// </summary>
+		size_t Advance(tick_type now)
+		{
+			size_t fired = 0;
+			while (fCurrent <= now)
+			{
+				const tick_type next = NextDeadline();
+				if (next > now)
+				{
+					// Nothing to do up to 'now', jump ahead.
+					fCurrent = now + 1;
+					break;
+				}
+
+				fCurrent = (std::max)(fCurrent, next);
+				fired += ProcessTick();
+			}
+			return fired;
+		}
+
+	private:
+		static constexpr size_t Levels = 4;
+		static constexpr size_t SlotBits = 6;
+		static constexpr size_t SlotsPerLevel = size_t{ 1 } << SlotBits;
+		static constexpr tick_type SlotMask = SlotsPerLevel - 1;
+		static constexpr tick_type MaxRange = (tick_type{ 1 } << (SlotBits * Levels)) - 1;
+
+		void Place(Timer& timer)
+		{
+			const tick_type deadline = (std::max)(timer.fDeadline, fCurrent);
+			// Timers beyond the range of the wheel are parked in the top level and re-placed when cascaded.
+			const tick_type delta = (std::min)(deadline - fCurrent, MaxRange);
+			const tick_type placedDeadline = fCurrent + delta;
+
+			size_t level = 0;
+			while (level < Levels - 1 && delta >= (tick_type{ 1 } << (SlotBits * (level + 1))))
+				level++;
+
+			const size_t index = static_cast<size_t>((placedDeadline >> (level * SlotBits)) & SlotMask);
+			const size_t slot = level * SlotsPerLevel + index;
+
+			timer.fSlot = static_cast<uint16_t>(slot);
+			timer.fPrev = nullptr;
+			timer.fNext = fSlots[slot];
+			if (timer.fNext != nullptr)
+				timer.fNext->fPrev = &timer;
+			fSlots[slot] = &timer;
+			fOccupied[level] |= uint64_t{ 1 } << index;
+		}
+
+		void Unlink(Timer& timer)
+		{
+			if (timer.fSlot == Timer::NotLinked)
+				return;
+
+			const size_t slot = timer.fSlot;
+			if (timer.fPrev != nullptr)
+				timer.fPrev->fNext = timer.fNext;
+			else
+				fSlots[slot] = timer.fNext;
+
+			if (timer.fNext != nullptr)
+				timer.fNext->fPrev = timer.fPrev;
+
+			if (fSlots[slot] == nullptr)
+				fOccupied[slot / SlotsPerLevel] &= ~(uint64_t{ 1 } << (slot % SlotsPerLevel));
+
+			timer.fPrev = nullptr;
+			timer.fNext = nullptr;
+			timer.fSlot = Timer::NotLinked;
+		}
+
+		void Cascade(size_t level, size_t index)
+		{
+			const size_t slot = level * SlotsPerLevel + index;
+			Timer* timer = fSlots[slot];
+			fSlots[slot] = nullptr;
+			fOccupied[level] &= ~(uint64_t{ 1 } << index);
+
+			while (timer != nullptr)
+			{
+				Timer* next = timer->fNext;
+				Place(*timer);
+				timer = next;
+			}
+		}
+
+		size_t ProcessTick()
+		{
+			const tick_type tick = fCurrent;
+			for (size_t level = 1; level < Levels; level++)
+			{
+				const size_t shift = level * SlotBits;
+				if ((tick & ((tick_type{ 1 } << shift) - 1)) != 0)
+					break;
+				Cascade(level, static_cast<size_t>((tick >> shift) & SlotMask));
+			}
+
+			// Advance before firing so timers re-scheduled by callbacks land in a later slot.
+			fCurrent = tick + 1;
+
+			size_t fired = 0;
+			const size_t slot = static_cast<size_t>(tick & SlotMask);
+			while (fSlots[slot] != nullptr)
+			{
+				Timer& timer = *fSlots[slot];
+				Cancel(timer);
+				fired++;
+				if (timer.fCallback)
+					timer.fCallback();
+			}
+			return fired;
+		}
+
+		std::array<Timer*, Levels * SlotsPerLevel> fSlots{};
+		std::array<uint64_t, Levels> fOccupied{};
+		tick_type fCurrent = 0;
+		size_t fCount = 0;
+	};
+}
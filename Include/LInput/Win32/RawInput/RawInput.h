@@ -21,9 +21,14 @@ SOFTWARE.
 */
 
 #pragma once
+#include <algorithm>
 #include <array>
 #include <climits>
-#include <map>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include <Windows.h>
 #include <LLUtils/Exception.h>
@@ -32,8 +37,13 @@ SOFTWARE.
 #include <LLUtils/Buffer.h>
 #include <LInput/Buttons/ButtonState.h>
 #include <LInput/Keys/KeyCodeHelper.h>
+#include <LInput/HID/GamepadState.h>
+#include <LInput/RawInput/DeviceRegistry.h>
+#include <LInput/RawInput/RawInputDecoder.h>
+#include <LInput/Timing/Clock.h>
 
 #include <type_traits>
+#include <utility>
 
 
 //Workaround for mingw
@@ -60,8 +70,11 @@ namespace LInput
     {
     public:
 
-        static constexpr size_t MaxMouseButtons = 8;
-        static constexpr size_t MaxHIDButtons = 32;
+        static constexpr size_t MaxMouseButtons = RawInputDecoder::MaxMouseButtons;
+        /// <summary>
+        /// Button masks, bit i represents button i.
+        /// </summary>
+        using MouseButtonMask = uint8_t;
         
 
         enum class UsagePage
@@ -144,6 +157,10 @@ namespace LInput
         {
             RawInputDeviceType deviceType;
             uint8_t deviceIndex;
+            /// <summary>
+            /// Time the input was received on SteadyClock, pass it on to the button states.
+            /// </summary>
+            SteadyClock::tick_type timeStamp;
 
         };
         struct RawInputEventKeyBoard : public RawInputEvent
@@ -157,22 +174,23 @@ namespace LInput
             int deltaX;
             int deltaY;
             int16_t wheelDelta;
-            std::array<ButtonState, MaxMouseButtons> buttonState;
+            /// <summary>
+            /// set bit - button is down
+            /// </summary>
+            MouseButtonMask buttonState;
+            /// <summary>
+            /// set bit - the state of the button is reported in 'buttonState'
+            /// </summary>
+            MouseButtonMask buttonStateValid;
         };
 
-        enum Axes
-        {
-              X
-            , Y
-            , Z
-            , HatSwitch
-            , ZRotate
-            , Count
-        };
         struct RawInputEventHID : public RawInputEvent
         {
-            std::array<ButtonState, MaxHIDButtons> buttonState;
-            std::array<int8_t, static_cast<size_t>(Axes::Count)> axes;
+            /// <summary>
+            /// State of the device after the report, sized from the device capabilities, see GamepadState.
+            /// Raised only when buttons or axes changed, GamepadState::GetChangedButtonWord and GetChangedAxes hold the delta.
+            /// </summary>
+            const GamepadState* state;
         };
 
 
@@ -182,7 +200,7 @@ namespace LInput
 
         OnInputType OnInput;
 
-        RawInput()  : fIds(1)
+        RawInput()  : fIds(1), fInputBuffer(InitialInputBufferSize), fBufferedLayout(GetBufferedLayout())
         {
             RegisterWindow();
         }
@@ -235,14 +253,18 @@ namespace LInput
             UnregisterWindow();
         }
 
-        void HandleRawInputKeyboard(RAWINPUTHEADER& header, RAWKEYBOARD& rawKeyboard)
+        void HandleRawInputKeyboard(const RawKeyboardInput& keyboard)
         {
+            const DeviceEntry* device = GetDevice(reinterpret_cast<HANDLE>(keyboard.device));
+            if (device == nullptr)
+                return;
+
             RawInputEventKeyBoard keyEvent{};
-            auto [button, state] = KeyCodeHelper::KeyEventFromRawInput(rawKeyboard);
-            keyEvent.state = state;
-			keyEvent.deviceIndex = GetDeviceID(static_cast<HRAWINPUT> (header.hDevice));
+            keyEvent.state = keyboard.state;
+			keyEvent.deviceIndex = device->info.deviceID;
             keyEvent.deviceType = RawInputDeviceType::Keyboard;
-            keyEvent.scanCode = button;
+            keyEvent.timeStamp = keyboard.timeStamp;
+            keyEvent.scanCode = keyboard.keyCode;
             OnInput.Raise(keyEvent);
         }
 
@@ -263,255 +285,436 @@ namespace LInput
 
         }
 
-        void HandleRawInputHID(RAWINPUTHEADER& header, RAWHID& rawHID)
+        /// <summary>
+        /// Buttons of a usage page, the union of the usage ranges of all the button caps on the page.
+        /// Button i of the page is button 'firstButton' + i of the state.
+        /// </summary>
+        struct HidButtonPage
         {
+            USAGE usagePage;
+            USAGE usageMin;
+            USAGE usageMax;
+            size_t firstButton;
+        };
 
-            RawInputEventHID evnt{ };
-            evnt.deviceType = RawInputDeviceType::GamePad;
-            evnt.deviceIndex = GetDeviceID(static_cast<HRAWINPUT>(header.hDevice));
-            std::fill(std::begin(evnt.buttonState), std::end(evnt.buttonState), ButtonState::Up);
+        /// <summary>
+        /// Value control of the state's axis at the same index, range value caps are expanded to one field per usage.
+        /// </summary>
+        struct HidValueField
+        {
+            size_t valueCaps;
+            USAGE usage;
+        };
 
-            USHORT               capsLength;
-            
-            std::array< USAGE, MaxHIDButtons> usage;
-            ULONG                i, usageLength, value;
+        /// <summary>
+        /// Preparsed data and capabilities of a HID device, queried once when the device arrives instead of on every report.
+        /// </summary>
+        struct HidDeviceCaps
+        {
+            std::vector<uint8_t> preparsedData;
+            HIDP_CAPS caps{};
+            std::vector<HIDP_BUTTON_CAPS> buttonCaps;
+            std::vector<HIDP_VALUE_CAPS> valueCaps;
+            std::vector<HidButtonPage> buttonPages;
+            std::vector<HidValueField> valueFields;
+            size_t numberOfButtons = 0;
+            /// <summary>
+            /// Reports start with the report ID, each report updates only the controls the caps place in it.
+            /// </summary>
+            bool usesReportIds = false;
+            /// <summary>
+            /// Scratch buffer for HidP_GetUsages, sized by HidP_MaxUsageListLength.
+            /// </summary>
+            std::vector<USAGE> usages;
+            GamepadState state;
+
+            PHIDP_PREPARSED_DATA GetPreparsedData()
+            {
+                return reinterpret_cast<PHIDP_PREPARSED_DATA>(preparsedData.data());
+            }
+        };
 
+        /// <summary>
+        /// First and last usage of button or value caps.
+        /// </summary>
+        template <typename Caps>
+        static std::pair<USAGE, USAGE> GetUsageRange(const Caps& caps)
+        {
+            return caps.IsRange ? std::make_pair(caps.Range.UsageMin, caps.Range.UsageMax) : std::make_pair(caps.NotRange.Usage, caps.NotRange.Usage);
+        }
 
-            //
-            // Get the preparsed data block
-            //
+        static HidDeviceCaps QueryHidDeviceCaps(HANDLE device)
+        {
+            HidDeviceCaps deviceCaps;
 
             UINT bufferSize{};
-            if (GetRawInputDeviceInfo(header.hDevice,
-                RIDI_PREPARSEDDATA, nullptr, &bufferSize) != 0)
+            if (GetRawInputDeviceInfo(device, RIDI_PREPARSEDDATA, nullptr, &bufferSize) != 0)
                 LL_EXCEPTION(LLUtils::Exception::ErrorCode::InvalidState, "could not get input device info");
 
-            LLUtils::Buffer preparseData(bufferSize);
+            deviceCaps.preparsedData.resize(bufferSize);
+            if (GetRawInputDeviceInfo(device, RIDI_PREPARSEDDATA, deviceCaps.preparsedData.data(), &bufferSize) != bufferSize)
+                LL_EXCEPTION(LLUtils::Exception::ErrorCode::InvalidState, "could not get input device info");
 
+            if (HidP_GetCaps(deviceCaps.GetPreparsedData(), &deviceCaps.caps) != HIDP_STATUS_SUCCESS)
+                LL_EXCEPTION(LLUtils::Exception::ErrorCode::InvalidState, "Unable to retrieve caps");
 
-            if (GetRawInputDeviceInfo(header.hDevice, RIDI_PREPARSEDDATA, reinterpret_cast<void*>(preparseData.data()), &bufferSize) != bufferSize)
-                LL_EXCEPTION(LLUtils::Exception::ErrorCode::InvalidState, "could not get input device info");
+            USHORT capsLength = deviceCaps.caps.NumberInputButtonCaps;
+            deviceCaps.buttonCaps.resize(capsLength);
+            if (capsLength > 0 && HidP_GetButtonCaps(HidP_Input, deviceCaps.buttonCaps.data(), &capsLength, deviceCaps.GetPreparsedData()) != HIDP_STATUS_SUCCESS)
+                LL_EXCEPTION(LLUtils::Exception::ErrorCode::InvalidState, "Unable to retrieve button caps");
 
+            capsLength = deviceCaps.caps.NumberInputValueCaps;
+            deviceCaps.valueCaps.resize(capsLength);
+            if (capsLength > 0 && HidP_GetValueCaps(HidP_Input, deviceCaps.valueCaps.data(), &capsLength, deviceCaps.GetPreparsedData()) != HIDP_STATUS_SUCCESS)
+                LL_EXCEPTION(LLUtils::Exception::ErrorCode::InvalidState, "Unable to retrieve value caps");
 
+            // Devices may split their buttons over several caps, e.g. one per report or per usage page.
+            for (const HIDP_BUTTON_CAPS& buttonCaps : deviceCaps.buttonCaps)
+            {
+                const auto [usageMin, usageMax] = GetUsageRange(buttonCaps);
+                auto it = std::find_if(deviceCaps.buttonPages.begin(), deviceCaps.buttonPages.end()
+                    , [&](const HidButtonPage& page) { return page.usagePage == buttonCaps.UsagePage; });
 
-            HIDP_CAPS caps;
-            // Button caps
-            if (HidP_GetCaps(reinterpret_cast<PHIDP_PREPARSED_DATA>(preparseData.data()), &caps) != HIDP_STATUS_SUCCESS)
-                LL_EXCEPTION(LLUtils::Exception::ErrorCode::InvalidState, "Unable to retrieve caps");
+                if (it == deviceCaps.buttonPages.end())
+                {
+                    deviceCaps.buttonPages.push_back(HidButtonPage{ buttonCaps.UsagePage, usageMin, usageMax, 0 });
+                }
+                else
+                {
+                    it->usageMin = (std::min)(it->usageMin, usageMin);
+                    it->usageMax = (std::max)(it->usageMax, usageMax);
+                }
+            }
 
-            //
-            // Get the joystick's capabilities
-            //
+            for (HidButtonPage& page : deviceCaps.buttonPages)
+            {
+                page.firstButton = deviceCaps.numberOfButtons;
+                deviceCaps.numberOfButtons += static_cast<size_t>(page.usageMax - page.usageMin) + 1;
+            }
 
-            capsLength = caps.NumberInputButtonCaps;
+            // Usage page 0 gives the longest list any page can return.
+            if (deviceCaps.buttonPages.empty() == false)
+                deviceCaps.usages.resize(HidP_MaxUsageListLength(HidP_Input, 0, deviceCaps.GetPreparsedData()));
+
+            std::vector<HidValueInfo> axes;
+            axes.reserve(deviceCaps.valueCaps.size());
+            for (size_t caps = 0; caps < deviceCaps.valueCaps.size(); caps++)
+            {
+                const HIDP_VALUE_CAPS& valueCaps = deviceCaps.valueCaps[caps];
+                // Logical Maximum 255 encoded in a single byte is a common descriptor bug, read it as unsigned.
+                LONG logicalMax = valueCaps.LogicalMax;
+                if (valueCaps.LogicalMin >= 0 && logicalMax < valueCaps.LogicalMin && valueCaps.BitSize < 32)
+                    logicalMax = static_cast<LONG>((ULONG{ 1 } << valueCaps.BitSize) - 1);
+
+                // A range, e.g. X to Rz in one cap, holds a separate value per usage.
+                const auto [usageMin, usageMax] = GetUsageRange(valueCaps);
+                for (uint32_t usage = usageMin; usage <= usageMax; usage++)
+                {
+                    deviceCaps.valueFields.push_back(HidValueField{ caps, static_cast<USAGE>(usage) });
+                    axes.push_back(HidValueInfo{ valueCaps.UsagePage, static_cast<uint16_t>(usage), static_cast<int32_t>(valueCaps.LogicalMin)
+                        , static_cast<int32_t>(logicalMax), static_cast<uint8_t>(valueCaps.BitSize) });
+                }
+            }
+            deviceCaps.usesReportIds = std::any_of(deviceCaps.buttonCaps.begin(), deviceCaps.buttonCaps.end(), [](const HIDP_BUTTON_CAPS& caps) { return caps.ReportID != 0; })
+                || std::any_of(deviceCaps.valueCaps.begin(), deviceCaps.valueCaps.end(), [](const HIDP_VALUE_CAPS& caps) { return caps.ReportID != 0; });
+            deviceCaps.state = GamepadState(deviceCaps.numberOfButtons, std::move(axes), deviceCaps.usesReportIds);
 
+            return deviceCaps;
+        }
 
+        /// <summary>
+        /// Registered device of a raw input handle.
+        /// </summary>
+        struct DeviceEntry
+        {
+            DeviceInfo info;
+            std::wstring name;
+            /// <summary>
+            /// Null for mice and keyboards.
+            /// </summary>
+            std::unique_ptr<HidDeviceCaps> hidCaps;
+        };
 
-            std::unique_ptr<HIDP_BUTTON_CAPS[]> pButtonCaps = std::make_unique< HIDP_BUTTON_CAPS[]>(caps.NumberInputButtonCaps);
+        void HandleRawInputHID(const RawHidInput& hid)
+        {
+            const DeviceEntry* device = GetDevice(reinterpret_cast<HANDLE>(hid.device));
+            if (device == nullptr || device->hidCaps == nullptr)
+                return;
 
+            HidDeviceCaps& deviceCaps = *device->hidCaps;
 
-            if (HidP_GetButtonCaps(HidP_Input, pButtonCaps.get(), &capsLength, reinterpret_cast<PHIDP_PREPARSED_DATA>(preparseData.data())) != HIDP_STATUS_SUCCESS)
-                LL_EXCEPTION(LLUtils::Exception::ErrorCode::InvalidState, "Unable to retrieve button caps");
+            // Idle devices keep sending the same report, drop it before decoding.
+            if (deviceCaps.state.ReportChanged(hid.report, hid.size) == false)
+                return;
 
-            USHORT g_NumberOfButtons = pButtonCaps.get()->Range.UsageMax - pButtonCaps.get()->Range.UsageMin + 1;
+            // HidP doesn't write to the report.
+            const PCHAR report = reinterpret_cast<PCHAR>(const_cast<uint8_t*>(hid.report));
 
-            // Value caps
-            std::unique_ptr<HIDP_VALUE_CAPS[]> pValueCaps = std::make_unique< HIDP_VALUE_CAPS[]>(caps.NumberInputValueCaps);
-            capsLength = caps.NumberInputValueCaps;
-            if (HidP_GetValueCaps(HidP_Input, pValueCaps.get(), &capsLength, reinterpret_cast<PHIDP_PREPARSED_DATA>(preparseData.data())) != HIDP_STATUS_SUCCESS)
-                LL_EXCEPTION(LLUtils::Exception::ErrorCode::InvalidState, "Unable to retrieve value caps");
+            RawInputEventHID evnt{ };
+            evnt.deviceType = RawInputDeviceType::GamePad;
+            evnt.timeStamp = hid.timeStamp;
+            evnt.deviceIndex = device->info.deviceID;
+
+            GamepadState& state = deviceCaps.state;
+            ULONG                i, usageLength, value;
+            NTSTATUS             status;
+
+            // Controls of other reports keep their state.
+            const UCHAR reportId = deviceCaps.usesReportIds ? static_cast<UCHAR>(hid.report[0]) : 0;
 
                 //
                 // Get the pressed buttons
                 //
 
-            usageLength = g_NumberOfButtons;
-            if (HidP_GetUsages(
-                    HidP_Input, pButtonCaps.get()->UsagePage, 0, usage.data(), &usageLength, reinterpret_cast<PHIDP_PREPARSED_DATA>(preparseData.data()),
-                    reinterpret_cast<PCHAR>(rawHID.bRawData), rawHID.dwSizeHid
-                ) != HIDP_STATUS_SUCCESS)
-                LL_EXCEPTION(LLUtils::Exception::ErrorCode::InvalidState, "Unable to retrieve usage values");
+            for (const HidButtonPage& page : deviceCaps.buttonPages)
+            {
+                bool inReport = false;
+                for (const HIDP_BUTTON_CAPS& buttonCaps : deviceCaps.buttonCaps)
+                {
+                    if (buttonCaps.UsagePage != page.usagePage || buttonCaps.ReportID != reportId)
+                        continue;
+
+                    inReport = true;
+                    const auto [usageMin, usageMax] = GetUsageRange(buttonCaps);
+                    for (uint32_t usage = usageMin; usage <= usageMax; usage++)
+                        state.SetButton(page.firstButton + (usage - page.usageMin), false);
+                }
 
+                if (inReport == false)
+                    continue;
+
+                usageLength = static_cast<ULONG>(deviceCaps.usages.size());
+                status = HidP_GetUsages(
+                        HidP_Input, page.usagePage, 0, deviceCaps.usages.data(), &usageLength, deviceCaps.GetPreparsedData(),
+                        report, hid.size
+                    );
+                if (status == HIDP_STATUS_INCOMPATIBLE_REPORT_ID)
+                    continue;
+                if (status != HIDP_STATUS_SUCCESS)
+                    LL_EXCEPTION(LLUtils::Exception::ErrorCode::InvalidState, "Unable to retrieve usage values");
 
-            for (i = 0; i < usageLength; i++)
-                evnt.buttonState[usage[i] - pButtonCaps.get()->Range.UsageMin] = ButtonState::Down;
+                for (i = 0; i < usageLength; i++)
+                    state.SetButton(page.firstButton + static_cast<size_t>(deviceCaps.usages[i] - page.usageMin), true);
+            }
 
             //
             // Get the state of discrete-valued-controls
             //
 
-            for (i = 0; i < caps.NumberInputValueCaps; i++ )
+            for (i = 0; i < deviceCaps.valueFields.size(); i++ )
             {
-                
-                if (HidP_GetUsageValue(
-                    HidP_Input, pValueCaps[i].UsagePage, 0, pValueCaps[i].Range.UsageMin, &value, reinterpret_cast<PHIDP_PREPARSED_DATA>(preparseData.data()),
-                    reinterpret_cast<PCHAR>(rawHID.bRawData), rawHID.dwSizeHid
-                ) != HIDP_STATUS_SUCCESS)
+                const HidValueField& field = deviceCaps.valueFields[i];
+                const HIDP_VALUE_CAPS& valueCaps = deviceCaps.valueCaps[field.valueCaps];
+                if (valueCaps.ReportID != reportId)
+                    continue;
+
+                // The link collection tells apart the same usage in different collections, e.g. the X of each stick.
+                status = HidP_GetUsageValue(
+                    HidP_Input, valueCaps.UsagePage, valueCaps.LinkCollection, field.usage, &value, deviceCaps.GetPreparsedData(),
+                    report, hid.size
+                );
+                if (status == HIDP_STATUS_INCOMPATIBLE_REPORT_ID)
+                    continue;
+                if (status != HIDP_STATUS_SUCCESS)
                     LL_EXCEPTION(LLUtils::Exception::ErrorCode::InvalidState, "Unable to retrieve usage values");
 
-                switch (pValueCaps[i].Range.UsageMin)
-                {
-                    //case RIV_BUTTON
-                case HID_USAGE_GENERIC_X:	// X-axis
-                    evnt.axes[static_cast<uint8_t>(Axes::X)] = static_cast<int8_t>(static_cast<std::make_signed_t<decltype(value)>>(value) - 128);
-                    break;
+                // HidP_GetUsageValue doesn't sign extend.
+                const ULONG signBit = valueCaps.LogicalMin < 0 && valueCaps.BitSize > 0 && valueCaps.BitSize < 32 ? ULONG{ 1 } << (valueCaps.BitSize - 1) : 0;
+                state.SetRawValue(i, static_cast<int32_t>(static_cast<int64_t>(value ^ signBit) - signBit));
+            }
 
-                case HID_USAGE_GENERIC_Y:	// Y-axis
-                    evnt.axes[static_cast<uint8_t>(Axes::Y)] = static_cast<int8_t>(static_cast<std::make_signed_t<decltype(value)>>(value) - 128);
-                    break;
+            if (state.CommitChanges() == false)
+                return;
 
-                case HID_USAGE_GENERIC_Z: // Z-axis
-                    evnt.axes[static_cast<uint8_t>(Axes::Z)] = static_cast<int8_t>(static_cast<std::make_signed_t<decltype(value)>>(value) - 128);
-                    break;
-                
+            evnt.state = &state;
+            OnInput.Raise(evnt);
+        }
 
-                case HID_USAGE_GENERIC_RZ: // Rotate-Z
-                    evnt.axes[static_cast<uint8_t>(Axes::ZRotate)] = static_cast<int8_t>(static_cast<std::make_signed_t<decltype(value)>>(value) - 128);
-                    break;
 
-                case HID_USAGE_GENERIC_HATSWITCH:	
-                    evnt.axes[static_cast<uint8_t>(Axes::HatSwitch)]  = static_cast<int8_t>(value);
-                    break;
-                }
-            }
+        void HandleRawInputMouse(const RawMouseInput& mouse)
+        {
+            const DeviceEntry* device = GetDevice(reinterpret_cast<HANDLE>(mouse.device));
+            if (device == nullptr)
+                return;
 
+            RawInputEventMouse evnt{};
+            evnt.deltaX = mouse.deltaX;
+            evnt.deltaY = mouse.deltaY;
+			evnt.deviceIndex = device->info.deviceID;
+            evnt.deviceType = RawInputDeviceType::Mouse;
+            evnt.timeStamp = mouse.timeStamp;
+            evnt.wheelDelta = mouse.wheelDelta;
+            evnt.buttonState = mouse.buttonState;
+            evnt.buttonStateValid = mouse.buttonStateValid;
             OnInput.Raise(evnt);
         }
 
+        /// <summary>
+        /// Registered device of 'handle', registered on first use if its arrival wasn't seen.
+        /// Null if the handle is no longer valid, e.g. input still queued after the device was removed.
+        /// </summary>
+        DeviceEntry* GetDevice(HANDLE handle)
+        {
+            DeviceEntry* entry = fDevices.Get(reinterpret_cast<uintptr_t>(handle));
+            return entry != nullptr ? entry : RegisterDevice(handle);
+        }
 
-        void HandleRawInputMouse(RAWINPUTHEADER& header, RAWMOUSE& mouse)
+        /// <summary>
+        /// A device that arrives again under a new handle keeps its ID, the entry of the old handle is dropped.
+        /// Returns null without registering if the device info can't be read.
+        /// </summary>
+        DeviceEntry* RegisterDevice(HANDLE handle)
         {
-            RawInputEventMouse evnt{};
-            evnt.deltaX = mouse.lLastX;
-            evnt.deltaY = mouse.lLastY;
-			evnt.deviceIndex = GetDeviceID(static_cast<HRAWINPUT>(header.hDevice));
-            evnt.deviceType = RawInputDeviceType::Mouse;
-            if (mouse.usButtonFlags == RI_MOUSE_WHEEL)
+            constexpr UINT Failed = static_cast<UINT>(-1);
+
+            UINT size = 0;
+            if (GetRawInputDeviceInfo(handle, RIDI_DEVICENAME, nullptr, &size) != 0 || size == 0)
+                return nullptr;
+
+            auto buffer = std::make_unique<wchar_t[]>(size);
+            const UINT nameLength = GetRawInputDeviceInfo(handle, RIDI_DEVICENAME, buffer.get(), &size);
+            if (nameLength == Failed || nameLength == 0)
+                return nullptr;
+
+            std::wstring deviceName(buffer.get(), std::find(buffer.get(), buffer.get() + (std::min)(nameLength, size), L'\0'));
+
+            RID_DEVICE_INFO info{};
+            info.cbSize = sizeof(info);
+            size = sizeof(info);
+            const UINT infoSize = GetRawInputDeviceInfo(handle, RIDI_DEVICEINFO, &info, &size);
+            if (infoSize == Failed || infoSize == 0)
+                return nullptr;
+
+            DeviceEntry entry{ DeviceInfo{ 0, static_cast<RawInputDeviceType>(info.dwType) }, std::move(deviceName), nullptr };
+
+            // Queried before an ID is taken, so a device that fails here doesn't hold one.
+            if (info.dwType == RIM_TYPEHID)
+                entry.hidCaps = std::make_unique<HidDeviceCaps>(QueryHidDeviceCaps(handle));
+
+            auto it = std::find_if(fDevices.begin(), fDevices.end(), [&entry](const auto& device) { return device.device.name == entry.name; });
+            if (it != fDevices.end())
             {
-                evnt.wheelDelta = static_cast<int16_t>(mouse.usButtonData) / WHEEL_DELTA;
+                entry.info.deviceID = it->device.info.deviceID;
+                if (it->handle != reinterpret_cast<uintptr_t>(handle))
+                    fDevices.Remove(it->handle);
             }
             else
             {
-                for (size_t i = 0; i < MaxMouseButtons; i++)
-                {
-                    ButtonState& state = evnt.buttonState[i];
-
-                    if (mouse.usButtonFlags & (1ul << (i * 2)))
-                        state = ButtonState::Down;
-
-                    if (mouse.usButtonFlags & (2ul << (i * 2)))
-                        state = ButtonState::Up;
-                }
+                entry.info.deviceID = fIds.Acquire();
             }
 
-            OnInput.Raise(evnt);
+            return &fDevices.Add(reinterpret_cast<uintptr_t>(handle), std::move(entry));
         }
 
-		uint8_t GetDeviceID(HRAWINPUT handle)
-		{
-			return fDevicehHandleToID.find(handle)->second;
-		}
-
-        void ProcessRawInputMessage(RAWINPUT* rawInput)
+        /// <summary>
+        /// Drops the device of 'handle' and recycles its ID.
+        /// </summary>
+        void UnregisterDevice(HANDLE handle)
         {
+            const DeviceEntry* entry = fDevices.Get(reinterpret_cast<uintptr_t>(handle));
+            if (entry == nullptr)
+                return;
+
+            fIds.Release(entry->info.deviceID);
+            fDevices.Remove(reinterpret_cast<uintptr_t>(handle));
+        }
 
-            if (rawInput->header.hDevice != nullptr) // Fix trackpad issues in laptops
+        /// <summary>
+        /// Raises the events of a decoded batch in arrival order.
+        /// </summary>
+        void ProcessRawInputBatch(const RawInputBatch& batch)
+        {
+            for (const RawInputBatch::Entry& entry : batch.order)
             {
-                switch (rawInput->header.dwType)
+                switch (entry.type)
                 {
-                case RIM_TYPEMOUSE:
-                    HandleRawInputMouse(rawInput->header, rawInput->data.mouse);
+                case RawInputBatch::EventType::Mouse:
+                    HandleRawInputMouse(batch.mouse[entry.index]);
                     break;
-                case RIM_TYPEKEYBOARD:
-                    HandleRawInputKeyboard(rawInput->header, rawInput->data.keyboard);
+                case RawInputBatch::EventType::Keyboard:
+                    HandleRawInputKeyboard(batch.keyboard[entry.index]);
                     break;
-                case RIM_TYPEHID:
-                    HandleRawInputHID(rawInput->header, rawInput->data.hid);
+                case RawInputBatch::EventType::Hid:
+                    HandleRawInputHID(batch.hid[entry.index]);
                     break;
-                default:
-                    LL_EXCEPTION_UNEXPECTED_VALUE;
-
                 }
             }
         }
 
+        void ProcessRawInputMessage(const RAWINPUT* rawInput)
+        {
+            ProcessRawInputBatch(fDecoder.Decode(reinterpret_cast<const uint8_t*>(rawInput), rawInput->header.dwSize, SteadyClock::Now(), 1));
+        }
 
-        LRESULT ProcessWInMessages([[maybe_unused]] HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam)
+        /// <summary>
+        /// Drains the raw input queue in bulk with GetRawInputBuffer and raises the events,
+        /// call from the message loop before dispatching messages, drained input doesn't generate WM_INPUT.
+        /// </summary>
+        void ProcessBufferedInput()
         {
-            switch (msg)
-            {
+            UINT recordSize{};
+            if (GetRawInputBuffer(nullptr, &recordSize, sizeof(RAWINPUTHEADER)) != 0)
+                LL_EXCEPTION_SYSTEM_ERROR("can not get raw input buffer size");
 
-            case  WM_INPUT:
+            if (recordSize == 0)
+                return;
+
+            // 'recordSize' is the size of the largest pending record, room for several is read per call.
+            const size_t bufferSize = RawInputRecord::AlignSize(recordSize, fBufferedLayout) * BufferedRecordsPerRead;
+            if (fInputBuffer.size() < bufferSize)
+                fInputBuffer.resize(bufferSize);
+
+            for (;;)
             {
-                UINT dwSize{};
-                if (GetRawInputData(reinterpret_cast<HRAWINPUT>(lparam), RID_INPUT, nullptr, &dwSize, sizeof(RAWINPUTHEADER)) != 0)
-                    LL_EXCEPTION_SYSTEM_ERROR("can not get raw input data");
+                UINT size = static_cast<UINT>(fInputBuffer.size());
+                const UINT count = GetRawInputBuffer(reinterpret_cast<PRAWINPUT>(fInputBuffer.data()), &size, sizeof(RAWINPUTHEADER));
+                const SteadyClock::tick_type timeStamp = SteadyClock::Now();
+                if (count == static_cast<UINT>(-1))
+                    LL_EXCEPTION_SYSTEM_ERROR("can not get raw input buffer");
+
+                if (count == 0)
+                    break;
 
+                ProcessRawInputBatch(fDecoder.Decode(fInputBuffer.data(), fInputBuffer.size(), timeStamp, count, fBufferedLayout));
+            }
+        }
 
-                LLUtils::Buffer lpb(dwSize);
 
+        LRESULT ProcessWInMessages([[maybe_unused]] HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam)
+        {
+            switch (msg)
+            {
 
-                if (GetRawInputData(reinterpret_cast<HRAWINPUT>(lparam),
-                    RID_INPUT,
-                    lpb.data(),
-                    &dwSize,
-                    sizeof(RAWINPUTHEADER)) != dwSize)
+            case  WM_INPUT:
+            {
+                const SteadyClock::tick_type timeStamp = SteadyClock::Now();
+                // The input buffer is kept between messages, the size is queried only when a record doesn't fit.
+                const HRAWINPUT rawInputHandle = reinterpret_cast<HRAWINPUT>(lparam);
+                UINT dwSize = static_cast<UINT>(fInputBuffer.size());
+                UINT bytesCopied = GetRawInputData(rawInputHandle, RID_INPUT, fInputBuffer.data(), &dwSize, sizeof(RAWINPUTHEADER));
+                if (bytesCopied == static_cast<UINT>(-1))
                 {
-                    LL_EXCEPTION_SYSTEM_ERROR("can not get raw input data");
+                    dwSize = 0;
+                    if (GetRawInputData(rawInputHandle, RID_INPUT, nullptr, &dwSize, sizeof(RAWINPUTHEADER)) != 0)
+                        LL_EXCEPTION_SYSTEM_ERROR("can not get raw input data");
+
+                    fInputBuffer.resize(dwSize);
+                    bytesCopied = GetRawInputData(rawInputHandle, RID_INPUT, fInputBuffer.data(), &dwSize, sizeof(RAWINPUTHEADER));
+                    if (bytesCopied == static_cast<UINT>(-1))
+                        LL_EXCEPTION_SYSTEM_ERROR("can not get raw input data");
                 }
 
-                ProcessRawInputMessage(reinterpret_cast<RAWINPUT*>(lpb.data()));
+                ProcessRawInputBatch(fDecoder.Decode(fInputBuffer.data(), bytesCopied, timeStamp, 1));
                 return 0;
             }
 
             case WM_INPUT_DEVICE_CHANGE:
             {
-                const HRAWINPUT rawInputHandle = reinterpret_cast<HRAWINPUT>(lparam);
+                const HANDLE deviceHandle = reinterpret_cast<HANDLE>(lparam);
                 if (wparam == GIDC_ARRIVAL)
-                {
-
-                    UINT size = 0;
-                    GetRawInputDeviceInfo(reinterpret_cast<HRAWINPUT>(lparam), RIDI_DEVICENAME, nullptr, &size);
-                    auto buffer = std::make_unique<wchar_t[]>(size);
-                    GetRawInputDeviceInfo(reinterpret_cast<HRAWINPUT>(lparam), RIDI_DEVICENAME, buffer.get(), &size);
-                    std::wstring deviceName(buffer.get());
-
-                    RID_DEVICE_INFO info;
-                    info.cbSize = sizeof(info);
-                    size = sizeof(info);
-                    GetRawInputDeviceInfo(reinterpret_cast<HRAWINPUT>(lparam), RIDI_DEVICEINFO, &info, &size);
-
-                    auto it = fDeviceNameToInfo.find(deviceName);
-                    uint8_t id = 0;
-                    if (it == std::end(fDeviceNameToInfo))
-                    {
-                        id = fIds.Acquire();
-                        fDeviceNameToInfo.emplace_hint(it, deviceName, DeviceInfo{ id , static_cast<RawInputDeviceType>(info.dwType)});
-                    }
-                    else
-                    {
-                        id = it->second.deviceID;
-                    }
-
-
-                    //Remove old handle if exists.
-
-                    for (const auto& p : fDevicehHandleToID)
-                    {
-                        if (p.second == id)
-                        {
-                            fDevicehHandleToID.erase(p.first);
-                            break;
-                        }
-                    }
-
-                    //Add new handle
-                    fDevicehHandleToID.emplace(rawInputHandle, id);
-                }
+                    RegisterDevice(deviceHandle);
                 else // (wparam == GIDC_REMOVAL)
-                {
-
-                }
+                    UnregisterDevice(deviceHandle);
             }
 
 
@@ -542,15 +745,41 @@ namespace LInput
 
     private:
 
+        static_assert(sizeof(RawInputRecord::Header) == sizeof(RAWINPUTHEADER), "RAWINPUTHEADER layout mismatch");
+        static_assert(sizeof(RawInputRecord::Mouse) == sizeof(RAWMOUSE) && offsetof(RAWMOUSE, usButtonFlags) == offsetof(RawInputRecord::Mouse, buttonFlags)
+            && offsetof(RAWMOUSE, lLastX) == offsetof(RawInputRecord::Mouse, lastX), "RAWMOUSE layout mismatch");
+        static_assert(sizeof(RawInputRecord::Keyboard) == sizeof(RAWKEYBOARD), "RAWKEYBOARD layout mismatch");
+        static_assert(offsetof(RAWINPUT, data) == sizeof(RawInputRecord::Header) && offsetof(RAWHID, bRawData) == sizeof(RawInputRecord::Hid), "RAWINPUT layout mismatch");
+
+        static_assert(sizeof(RawInputRecord::Header64) == 24, "RAWINPUTHEADER 64 bit layout mismatch");
+
+        /// <summary>
+        /// GetRawInputBuffer returns records with 64 bit headers and alignment to a 32 bit process on 64 bit Windows.
+        /// </summary>
+        static RawInputRecord::Layout GetBufferedLayout()
+        {
+#ifndef _WIN64
+            BOOL isWow64 = FALSE;
+            if (IsWow64Process(GetCurrentProcess(), &isWow64) != FALSE && isWow64 != FALSE)
+                return RawInputRecord::Layout::Wow64;
+#endif
+            return RawInputRecord::Layout::Native;
+        }
+
+        static constexpr size_t InitialInputBufferSize = 1024;
+        static constexpr size_t BufferedRecordsPerRead = 64;
+
         static inline const LLUtils::native_char_type CLASS_NAME[] = LLUTILS_TEXT("LInput.RawInput");
         static constexpr LLUtils::native_char_type sCurrentInstanceName[] = LLUTILS_TEXT("__LINPUT_CURRENT_INSTANCE__");
 
-    	using MapDeviceHandleToID = std::map<HRAWINPUT, uint8_t> ;
-		using MapDeviceNameToInfo = std::map<std::wstring, DeviceInfo>;
-		
-        MapDeviceHandleToID fDevicehHandleToID;
-        MapDeviceNameToInfo fDeviceNameToInfo;
+        DeviceRegistry<DeviceEntry> fDevices;
 		LLUtils::UniqueIdProvider<uint8_t> fIds;
+        RawInputDecoder fDecoder;
+        /// <summary>
+        /// Records are read into this buffer, it grows to the largest read and is reused.
+        /// </summary>
+        std::vector<uint8_t> fInputBuffer;
+        RawInputRecord::Layout fBufferedLayout;
         bool fEnabled = false;
         HWND fWindowHandle = nullptr;
     };